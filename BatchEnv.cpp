@@ -0,0 +1,152 @@
+#include "BatchEnv.hpp"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+BatchEnv::BatchEnv(int size, const BatchEnvConfig& batchConfig)
+    : config(batchConfig),
+      envs(std::max(size, 0)),
+      seeds(std::max(size, 0)),
+      episodeSteps(std::max(size, 0), 0)
+{
+    config.sim.headless = true;
+    config.sim.verbose = false;
+    config.sim.externalControl = true;
+    // The simulations never consult their own table under external control;
+    // an empty shared one keeps them from each loading the file.
+    if (!config.sim.qTable) {
+        config.sim.qTable = std::make_shared<const DenseQTable>();
+    }
+    config.threads = std::max(1, config.threads);
+    // A replay ring takes one producer; the simulations log in turn instead.
+    if (config.sim.replay && config.threads > 1) {
+        std::cerr << "Replay logging steps the batch on one thread" << std::endl;
+        config.threads = 1;
+    }
+    config.threads = std::min(config.threads, std::max(size, 1));
+    errors.resize(config.threads);
+    for (int slice = 1; slice < config.threads; ++slice) {
+        workers.emplace_back(&BatchEnv::workerLoop, this, slice);
+    }
+}
+
+BatchEnv::~BatchEnv() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        stopping = true;
+    }
+    stepReady.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void BatchEnv::workerLoop(int slice) {
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            stepReady.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        // An exception escaping a std::thread would terminate the process;
+        // step() rethrows it on the caller's thread instead.
+        try {
+            stepSlice(slice);
+        } catch (...) {
+            errors[slice] = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (--pending == 0) {
+            stepDone.notify_one();
+        }
+    }
+}
+
+void BatchEnv::startEpisode(int i) {
+    SimConfig sim = config.sim;
+    // Keep clear of 0, which would seed from the clock.
+    sim.seed = seeds[i].next() | 1;
+    sim.spawnInterval = config.spawnMin + (config.spawnMax - config.spawnMin) * seeds[i].nextFloat();
+    envs[i] = std::make_unique<TrafficManager>(sim);
+    episodeSteps[i] = 0;
+    envs[i]->runToDecision(config.dt, config.maxDecisionWait);
+}
+
+void BatchEnv::reset(std::uint64_t seed, int* queueNS, int* queueEW) {
+    for (int i = 0; i < size(); ++i) {
+        seeds[i] = SimRng(seed * 0x9E3779B97F4A7C15ull + static_cast<std::uint64_t>(i));
+        startEpisode(i);
+        std::pair<int, int> state = envs[i]->getQueueState();
+        queueNS[i] = state.first;
+        queueEW[i] = state.second;
+    }
+}
+
+void BatchEnv::stepRange(int begin, int end, const int* actions, int* queueNS, int* queueEW,
+                         double* rewards, unsigned char* done) {
+    for (int i = begin; i < end; ++i) {
+        TrafficManager& env = *envs[i];
+        env.applyAction(actions[i]);
+        bool decided = env.runToDecision(config.dt, config.maxDecisionWait);
+        // Without a new decision the last reward is stale.
+        rewards[i] = decided ? env.getLastReward() : 0.0;
+        ++episodeSteps[i];
+        bool ended = !decided || (config.episodeDecisions > 0 && episodeSteps[i] >= config.episodeDecisions);
+        done[i] = ended ? 1 : 0;
+        if (ended && decided) {
+            // The transition just logged is the episode's last; a timed-out
+            // episode has no transition for its final action.
+            env.endEpisode();
+        }
+        if (ended) {
+            startEpisode(i);
+        }
+        std::pair<int, int> state = envs[i]->getQueueState();
+        queueNS[i] = state.first;
+        queueEW[i] = state.second;
+    }
+}
+
+void BatchEnv::stepSlice(int slice) {
+    // Contiguous slices, so each thread writes its own stretch of the output arrays.
+    long long count = size();
+    int begin = static_cast<int>(count * slice / config.threads);
+    int end = static_cast<int>(count * (slice + 1) / config.threads);
+    stepRange(begin, end, current.actions, current.queueNS, current.queueEW, current.rewards, current.done);
+}
+
+void BatchEnv::step(const int* actions, int* queueNS, int* queueEW, double* rewards, unsigned char* done) {
+    if (workers.empty()) {
+        stepRange(0, size(), actions, queueNS, queueEW, rewards, done);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            current = { actions, queueNS, queueEW, rewards, done };
+            pending = static_cast<int>(workers.size());
+            ++generation;
+        }
+        stepReady.notify_all();
+        // The pool is still writing the caller's buffers; wait for it before rethrowing.
+        try {
+            stepSlice(0);
+        } catch (...) {
+            errors[0] = std::current_exception();
+        }
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            stepDone.wait(lock, [&] { return pending == 0; });
+        }
+        for (auto& error : errors) {
+            if (error) {
+                std::exception_ptr thrown = error;
+                std::fill(errors.begin(), errors.end(), nullptr);
+                std::rethrow_exception(thrown);
+            }
+        }
+    }
+    decisions += size();
+}
@@ -0,0 +1,89 @@
+#ifndef BATCHENV_HPP
+#define BATCHENV_HPP
+
+#include "TrafficManager.hpp"
+#include "SimRng.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Settings shared by every simulation in a batch.
+struct BatchEnvConfig {
+    SimConfig sim;                // Forced headless, quiet and externally controlled.
+    float dt = 0.1f;              // Simulation step while running to the next decision.
+    float maxDecisionWait = 120.f;  // Simulated seconds to wait for a decision before ending the episode.
+    int episodeDecisions = 200;   // Decisions per episode; 0 runs until a decision times out.
+    float spawnMin = 1.f;         // Each episode draws its spawn interval from [spawnMin, spawnMax].
+    float spawnMax = 1.f;
+    int threads = 1;              // Threads stepping slices of the batch; 1 when sim.replay is set.
+                                  // They are started once and live as long as the batch.
+};
+
+// B independent single-intersection simulations stepped in lockstep, one
+// decision per step, for RL sample collection. Results come back
+// structure-of-arrays in caller buffers of B entries each: queueNS, queueEW,
+// reward and done. An episode that ends is reset in place with the next seed
+// of its environment's own stream, so the states returned alongside done = 1
+// are already those of the new episode and stepping never stops.
+class BatchEnv {
+public:
+    BatchEnv(int size, const BatchEnvConfig& config);
+    ~BatchEnv();
+
+    BatchEnv(const BatchEnv&) = delete;
+    BatchEnv& operator=(const BatchEnv&) = delete;
+
+    int size() const { return static_cast<int>(envs.size()); }
+
+    // Starts a fresh episode everywhere; environment i draws its seeds from a
+    // stream derived from seed and i.
+    void reset(std::uint64_t seed, int* queueNS, int* queueEW);
+    // Applies actions[i] (0 = keep, 1 = +1 s green, 2 = -1 s green) to every
+    // environment and runs each to its next decision. An exception thrown while
+    // stepping any slice is rethrown here once every slice has finished.
+    void step(const int* actions, int* queueNS, int* queueEW, double* rewards, unsigned char* done);
+
+    // Total decisions taken since construction.
+    long long getDecisions() const { return decisions; }
+
+private:
+    void startEpisode(int i);
+    void stepRange(int begin, int end, const int* actions, int* queueNS, int* queueEW,
+                   double* rewards, unsigned char* done);
+    // Steps slice `slice` of the current step's arguments.
+    void stepSlice(int slice);
+    // Body of pool thread `slice`: steps its slice each time step() publishes one.
+    void workerLoop(int slice);
+
+    // Arguments of the step in progress, published to the pool by step().
+    struct StepArgs {
+        const int* actions = nullptr;
+        int* queueNS = nullptr;
+        int* queueEW = nullptr;
+        double* rewards = nullptr;
+        unsigned char* done = nullptr;
+    };
+
+    BatchEnvConfig config;
+    std::vector<std::unique_ptr<TrafficManager>> envs;
+    std::vector<SimRng> seeds;        // Per-environment seed stream.
+    std::vector<int> episodeSteps;    // Decisions taken in each current episode.
+    long long decisions = 0;
+
+    // Pool threads for slices 1.. of each step; the calling thread takes slice 0.
+    std::vector<std::thread> workers;
+    std::mutex poolMutex;
+    std::condition_variable stepReady;   // A new generation of work, or shutdown.
+    std::condition_variable stepDone;    // The last pending slice finished.
+    StepArgs current;
+    std::vector<std::exception_ptr> errors;  // Per slice: what its last step threw, if anything.
+    unsigned long long generation = 0;   // Bumped once per step() that uses the pool.
+    int pending = 0;                     // Pool slices of the current step still running.
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a 64 of a byte range. Policy files and checkpoints store it to detect
+// truncated or damaged data; it is not meant to resist deliberate tampering.
+inline std::uint64_t fnv1a64(const char* data, std::size_t size) {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "CorridorController.hpp"
+#include <chrono>
+#include <utility>
+
+CorridorController::CorridorController(std::shared_ptr<const QFunction> controllerPolicy, bool batchedInference)
+    : policy(std::move(controllerPolicy)),
+      batched(batchedInference)
+{
+}
+
+TrafficManager& CorridorController::addIntersection(SimConfig config) {
+    config.externalControl = true;
+    config.qFunction.reset();
+    intersections.push_back(std::make_unique<TrafficManager>(config));
+    return *intersections.back();
+}
+
+void CorridorController::update(float dt) {
+    for (auto& intersection : intersections) {
+        intersection->update(dt);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pending.clear();
+    for (int i = 0; i < size(); ++i) {
+        if (intersections[i]->isDecisionPending()) {
+            pending.push_back(i);
+        }
+    }
+    int count = static_cast<int>(pending.size());
+    if (count == 0) {
+        return;
+    }
+
+    observations.resize(static_cast<size_t>(count) * kObservationSize);
+    qValues.resize(static_cast<size_t>(count) * kQActions);
+    for (int k = 0; k < count; ++k) {
+        intersections[pending[k]]->getObservation(&observations[static_cast<size_t>(k) * kObservationSize]);
+    }
+    if (batched) {
+        policy->evaluateBatch(observations.data(), count, qValues.data());
+    } else {
+        for (int k = 0; k < count; ++k) {
+            policy->evaluate(&observations[static_cast<size_t>(k) * kObservationSize],
+                             &qValues[static_cast<size_t>(k) * kQActions]);
+        }
+    }
+    for (int k = 0; k < count; ++k) {
+        const float* q = &qValues[static_cast<size_t>(k) * kQActions];
+        // Ties go to the lower action, as with QFunction::greedy.
+        int best = q[1] > q[0] ? 1 : 0;
+        intersections[pending[k]]->applyAction(q[2] > q[best] ? 2 : best);
+    }
+
+    decisions += count;
+    ++batches;
+    policySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
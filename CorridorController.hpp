@@ -0,0 +1,48 @@
+#ifndef CORRIDORCONTROLLER_HPP
+#define CORRIDORCONTROLLER_HPP
+
+#include "TrafficManager.hpp"
+#include "QFunction.hpp"
+#include <memory>
+#include <vector>
+
+// Drives many intersections (e.g. a 200-signal corridor) from one Q-function.
+// Each tick steps every intersection; those whose phase ended have a decision
+// pending (external control), and their observations are gathered into one
+// contiguous batch, evaluated with a single QFunction::evaluateBatch call and
+// the actions scattered back before the next tick. The phase has already
+// changed when the decision pends, so the run is the same as deciding inline;
+// only the policy evaluation is batched.
+class CorridorController {
+public:
+    // batched = false evaluates each decision on its own, in intersection
+    // order, for comparison.
+    explicit CorridorController(std::shared_ptr<const QFunction> policy, bool batched = true);
+
+    // Adds an intersection; it is switched to external control.
+    TrafficManager& addIntersection(SimConfig config);
+    int size() const { return static_cast<int>(intersections.size()); }
+    TrafficManager& getIntersection(int i) { return *intersections[i]; }
+
+    // Steps every intersection by dt, then decides every phase that ended.
+    void update(float dt);
+
+    long long getDecisions() const { return decisions; }
+    long long getBatches() const { return batches; }
+    // Wall-clock seconds spent gathering, evaluating and scattering decisions.
+    double getPolicySeconds() const { return policySeconds; }
+
+private:
+    std::shared_ptr<const QFunction> policy;
+    bool batched;
+    std::vector<std::unique_ptr<TrafficManager>> intersections;
+    // Per-tick batch, reused across ticks.
+    std::vector<int> pending;
+    std::vector<float> observations;
+    std::vector<float> qValues;
+    long long decisions = 0;
+    long long batches = 0;
+    double policySeconds = 0.0;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "DemandProfile.hpp"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+bool DemandProfile::open(const std::string& filename) {
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open demand profile: " << filename << std::endl;
+        return false;
+    }
+
+    // Detect the binary format from its magic; anything else is read as CSV.
+    DemandFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (file.gcount() == static_cast<std::streamsize>(sizeof(header)) &&
+        std::memcmp(header.magic, "TDP1", 4) == 0) {
+        if (header.approaches != kDemandApproaches || header.binSeconds <= 0.f) {
+            std::cerr << "Unsupported demand profile layout in " << filename << std::endl;
+            file.close();
+            return false;
+        }
+        binary = true;
+        binSeconds = header.binSeconds;
+    } else {
+        binary = false;
+        binSeconds = kDefaultBinSeconds;
+        file.clear();
+        file.seekg(0);
+    }
+
+    currentStart = 0.0;
+    if (!readNextBin(current)) {
+        std::cerr << "Demand profile " << filename << " contains no bins" << std::endl;
+        file.close();
+        return false;
+    }
+    hasNext = readNextBin(next);
+    return true;
+}
+
+void DemandProfile::rewind() {
+    if (!file.is_open()) {
+        return;
+    }
+    file.clear();
+    file.seekg(binary ? static_cast<std::streamoff>(sizeof(DemandFileHeader)) : 0);
+    currentStart = 0.0;
+    if (readNextBin(current)) {
+        hasNext = readNextBin(next);
+    }
+}
+
+DemandProfile DemandProfile::snapshot() const {
+    DemandProfile copy;
+    copy.binary = binary;
+    copy.binSeconds = binSeconds;
+    copy.current = current;
+    copy.next = next;
+    copy.currentStart = currentStart;
+    copy.hasNext = hasNext;
+    return copy;
+}
+
+bool DemandProfile::readNextBin(DemandBin& bin) {
+    if (binary) {
+        file.read(reinterpret_cast<char*>(&bin), sizeof(bin));
+        return file.gcount() == static_cast<std::streamsize>(sizeof(bin));
+    }
+    return readCsvBin(bin);
+}
+
+bool DemandProfile::readCsvBin(DemandBin& bin) {
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        for (char& c : line) {
+            if (c == ',') c = ' ';
+        }
+        std::istringstream iss(line);
+        int i = 0;
+        while (i < kDemandApproaches && iss >> bin.flow[i]) {
+            ++i;
+        }
+        if (i == kDemandApproaches) {
+            return true;
+        }
+        // Header or malformed line: skip it.
+    }
+    return false;
+}
+
+void DemandProfile::sample(double t, float out[kDemandApproaches]) {
+    // Advance the two-bin window until t falls inside the current bin.
+    while (hasNext && t >= currentStart + binSeconds) {
+        current = next;
+        currentStart += binSeconds;
+        hasNext = readNextBin(next);
+    }
+
+    if (!hasNext) {
+        // Past the last bin: hold its flows.
+        for (int a = 0; a < kDemandApproaches; ++a) {
+            out[a] = current.flow[a];
+        }
+        return;
+    }
+
+    // Linear interpolation from the start of the current bin to the start of the next.
+    float frac = static_cast<float>((t - currentStart) / binSeconds);
+    if (frac < 0.f) frac = 0.f;
+    for (int a = 0; a < kDemandApproaches; ++a) {
+        out[a] = current.flow[a] + (next.flow[a] - current.flow[a]) * frac;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef DEMANDPROFILE_HPP
+#define DEMANDPROFILE_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Number of approaches a profile carries flows for, in the order of the
+// Direction enum: TopToBottom, BottomToTop, LeftToRight, RightToLeft.
+constexpr int kDemandApproaches = 4;
+
+// Flow rates (vehicles per hour) for every approach during one time bin.
+struct DemandBin {
+    float flow[kDemandApproaches];
+};
+
+// Header of the compact binary profile format. It is followed by one
+// DemandBin record per bin, written back to back.
+struct DemandFileHeader {
+    char magic[4];          // "TDP1"
+    std::uint32_t approaches;
+    float binSeconds;
+    std::uint32_t reserved;
+};
+
+// Streams a time-varying demand profile from disk.
+// Only the current and next bins are kept in memory, so day- or week-long
+// count data can be replayed without loading the whole file up front.
+//
+// CSV format: one bin per line with four comma-separated flows
+// (top_to_bottom, bottom_to_top, left_to_right, right_to_left), in vehicles per hour.
+// Lines starting with '#' and a non-numeric header line are skipped.
+// Every bin covers 15 minutes.
+class DemandProfile {
+public:
+    static constexpr float kDefaultBinSeconds = 900.f;
+
+    // Opens a CSV or binary profile (detected from the "TDP1" magic).
+    bool open(const std::string& filename);
+    bool isOpen() const { return file.is_open(); }
+    // Goes back to the first bin, e.g. after restoring an earlier simulation state.
+    void rewind();
+    // Copy of the current two-bin window without the file stream, for simulation
+    // forks. It interpolates exactly up to the start of the next bin and holds that
+    // bin afterwards, which covers rollouts shorter than a bin.
+    DemandProfile snapshot() const;
+
+    // Writes the flows interpolated at simulation time t (seconds) into out.
+    // t must not decrease between calls; the stream only moves forward.
+    void sample(double t, float out[kDemandApproaches]);
+
+private:
+    bool readNextBin(DemandBin& bin);
+    bool readCsvBin(DemandBin& bin);
+
+    std::ifstream file;
+    bool binary = false;
+    float binSeconds = kDefaultBinSeconds;
+
+    DemandBin current{};
+    DemandBin next{};
+    double currentStart = 0.0;  // Start time of the current bin (seconds).
+    bool hasNext = false;
+};
+
+#endif
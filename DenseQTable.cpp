@@ -0,0 +1,97 @@
+#include "DenseQTable.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include "MappedFile.hpp"
+
+DenseQTable::DenseQTable(int nsStates, int ewStates)
+    : nsCount(std::max(nsStates, 0)),
+      ewCount(std::max(ewStates, 0)),
+      owned((static_cast<size_t>(nsCount) * ewCount + 1) * kQActions, std::numeric_limits<double>::quiet_NaN()),
+      q(owned.data())
+{
+}
+
+DenseQTable::DenseQTable(int nsStates, int ewStates, std::shared_ptr<const MappedFile> mapping,
+                         const double* values)
+    : nsCount(nsStates),
+      ewCount(ewStates),
+      mapping(std::move(mapping)),
+      q(values)
+{
+}
+
+DenseQTable::DenseQTable(const DenseQTable& other)
+    : nsCount(other.nsCount),
+      ewCount(other.ewCount),
+      owned(other.owned),
+      mapping(other.mapping),
+      q(other.mapping ? other.q : owned.data())
+{
+}
+
+DenseQTable& DenseQTable::operator=(DenseQTable other) noexcept {
+    // Swapping the vectors swaps their buffers, so q stays valid on both sides.
+    std::swap(nsCount, other.nsCount);
+    std::swap(ewCount, other.ewCount);
+    owned.swap(other.owned);
+    mapping.swap(other.mapping);
+    std::swap(q, other.q);
+    return *this;
+}
+
+DenseQTable DenseQTable::detached() const {
+    DenseQTable copy(nsCount, ewCount);
+    std::copy(q, q + valueCount(), copy.owned.begin());
+    return copy;
+}
+
+// Parses a "(ns, ew)" key within [0, kMaxQueueState]; false for anything else.
+static bool parseStateKey(const std::string& key, int& ns, int& ew) {
+    return std::sscanf(key.c_str(), " (%d , %d )", &ns, &ew) == 2 && ns >= 0 && ew >= 0 &&
+           ns <= kMaxQueueState && ew <= kMaxQueueState;
+}
+
+DenseQTable DenseQTable::fromQTable(const QTable& table) {
+    int nsMax = -1;
+    int ewMax = -1;
+    for (const auto& entry : table) {
+        int ns, ew;
+        if (parseStateKey(entry.first, ns, ew)) {
+            nsMax = std::max(nsMax, ns);
+            ewMax = std::max(ewMax, ew);
+        }
+    }
+
+    DenseQTable dense(nsMax + 1, ewMax + 1);
+    for (const auto& entry : table) {
+        int ns, ew;
+        if (!parseStateKey(entry.first, ns, ew)) {
+            std::cerr << "Skipping Q-table key " << entry.first << std::endl;
+            continue;
+        }
+        if (entry.second.size() != static_cast<size_t>(kQActions)) {
+            std::cerr << "Skipping Q-table state " << entry.first << ": expected "
+                      << kQActions << " action values" << std::endl;
+            continue;
+        }
+        std::copy(entry.second.begin(), entry.second.end(), dense.mutableValues(ns, ew));
+    }
+    return dense;
+}
+
+QTable DenseQTable::toQTable() const {
+    QTable table;
+    for (int ns = 0; ns < nsCount; ++ns) {
+        for (int ew = 0; ew < ewCount; ++ew) {
+            const double* v = values(ns, ew);
+            if (isKnown(v)) {
+                table["(" + std::to_string(ns) + ", " + std::to_string(ew) + ")"] =
+                    std::vector<double>(v, v + kQActions);
+            }
+        }
+    }
+    return table;
+}
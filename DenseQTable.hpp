@@ -0,0 +1,87 @@
+#ifndef DENSEQTABLE_HPP
+#define DENSEQTABLE_HPP
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Number of controller actions: 0 = keep, 1 = +1 s green, 2 = -1 s green.
+constexpr int kQActions = 3;
+// Largest queue length a Q-table state may name. Tables are dense, so a
+// single larger key would otherwise size the table to match it.
+constexpr int kMaxQueueState = 1024;
+
+class MappedFile;
+
+// Q-table as exchanged in q_table.json: "(ns, ew)" keys mapping to action values.
+using QTable = std::unordered_map<std::string, std::vector<double>>;
+
+// Dense Q-table indexed directly by the (queueNS, queueEW) state.
+// Values live in one contiguous array laid out as [ns][ew][action], so a lookup
+// is an index computation and the greedy action a compare over three inline
+// doubles. States the table has never seen, and states beyond its bounds, read
+// as unknown (NaN values) from a shared sentinel row.
+//
+// A table either owns its values or reads them in place from a mapped policy
+// file (see QTableLoader::loadPolicyFile), which it keeps mapped while in use.
+class DenseQTable {
+public:
+    DenseQTable() : DenseQTable(0, 0) {}
+    // A table of nsStates x ewStates states, all unknown.
+    DenseQTable(int nsStates, int ewStates);
+    // A read-only view of (nsStates * ewStates + 1) * kQActions values, sentinel row
+    // included, inside a mapped file.
+    DenseQTable(int nsStates, int ewStates, std::shared_ptr<const MappedFile> mapping, const double* values);
+
+    DenseQTable(const DenseQTable& other);
+    DenseQTable(DenseQTable&& other) noexcept = default;
+    DenseQTable& operator=(DenseQTable other) noexcept;
+
+    // Converts a keyed table; its bounds are the largest queues it mentions.
+    static DenseQTable fromQTable(const QTable& table);
+    // And back, with only the known states, e.g. for writing q_table.json.
+    QTable toQTable() const;
+    // A copy that owns its values, e.g. to stop depending on a mapped file that
+    // may be rewritten in place.
+    DenseQTable detached() const;
+
+    int nsStates() const { return nsCount; }
+    int ewStates() const { return ewCount; }
+    // All values, sentinel row included, e.g. for writing a policy file.
+    const double* data() const { return q; }
+    size_t valueCount() const { return (sentinelRow() + 1) * kQActions; }
+
+    // The kQActions values of a state. Out-of-range states map to the sentinel
+    // row without branching.
+    const double* values(int ns, int ew) const {
+        unsigned uns = static_cast<unsigned>(ns);
+        unsigned uew = static_cast<unsigned>(ew);
+        bool inside = (uns < static_cast<unsigned>(nsCount)) & (uew < static_cast<unsigned>(ewCount));
+        size_t row = inside ? static_cast<size_t>(uns) * ewCount + uew : sentinelRow();
+        return &q[row * kQActions];
+    }
+    // Writable values of an in-range state (for training); owned tables only.
+    double* mutableValues(int ns, int ew) {
+        return &owned[(static_cast<size_t>(ns) * ewCount + ew) * kQActions];
+    }
+
+    static bool isKnown(const double* qValues) { return !std::isnan(qValues[0]); }
+    // Index of the largest value; ties go to the lower action, as with std::max_element.
+    static int argmax(const double* qValues) {
+        int best = qValues[1] > qValues[0] ? 1 : 0;
+        return qValues[2] > qValues[best] ? 2 : best;
+    }
+
+private:
+    size_t sentinelRow() const { return static_cast<size_t>(nsCount) * ewCount; }
+
+    int nsCount;
+    int ewCount;
+    std::vector<double> owned;                   // Values owned by the table...
+    std::shared_ptr<const MappedFile> mapping;   // ...or the mapped file they live in.
+    const double* q = nullptr;                   // (nsCount * ewCount + 1) rows of kQActions values.
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "LinearPolicy.hpp"
+#include "SimdKernels.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const std::uint32_t kLinearPolicyVersion = 1;
+static const int kMaxLinearFeatures = 1716;
+
+// Monomials of n variables up to degree d: C(n + d, d).
+static int monomialCount(int n, int d) {
+    long long count = 1;
+    for (int k = 1; k <= d; ++k) {
+        count = count * (n + k) / k;
+    }
+    return static_cast<int>(count);
+}
+
+LinearPolicy::LinearPolicy(int policyDegree)
+    : degree(std::clamp(policyDegree, 1, kMaxLinearDegree)),
+      featureCount(monomialCount(kObservationSize, degree)),
+      weights(static_cast<size_t>(kQActions) * featureCount, 0.f)
+{
+}
+
+void LinearPolicy::features(const float* observation, float* out) const {
+    // Block of degree k: for each variable i, x_i times the degree k-1
+    // monomials whose lowest variable is >= i (a suffix of the previous block).
+    // Degree 1 is the observation itself.
+    int start[kObservationSize];
+    out[0] = 1.f;
+    for (int i = 0; i < kObservationSize; ++i) {
+        out[1 + i] = observation[i];
+        start[i] = 1 + i;
+    }
+    int blockEnd = 1 + kObservationSize;
+    for (int k = 2; k <= degree; ++k) {
+        int next = blockEnd;
+        for (int i = 0; i < kObservationSize; ++i) {
+            int from = start[i];
+            // In the new block, monomials with lowest variable >= i start here.
+            start[i] = next;
+            simd::scale(observation[i], out + from, out + next, blockEnd - from);
+            next += blockEnd - from;
+        }
+        blockEnd = next;
+    }
+}
+
+void LinearPolicy::evaluate(const float* observation, float* qValues) const {
+    float phi[kMaxLinearFeatures];
+    features(observation, phi);
+    simd::matvec(weights.data(), kQActions, featureCount, phi, qValues);
+}
+
+void LinearPolicy::update(const float* featureValues, int action, float step) {
+    simd::axpy(step, featureValues, &weights[static_cast<size_t>(action) * featureCount], featureCount);
+}
+
+bool LinearPolicy::save(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to write linear policy: " << filename << std::endl;
+        return false;
+    }
+    LinearPolicyHeader header{};
+    std::memcpy(header.magic, "TLP1", 4);
+    header.version = kLinearPolicyVersion;
+    header.observationSize = kObservationSize;
+    header.actions = kQActions;
+    header.degree = static_cast<std::uint32_t>(degree);
+    header.featureCount = static_cast<std::uint32_t>(featureCount);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(weights.data()),
+               static_cast<std::streamsize>(weights.size() * sizeof(float)));
+    return static_cast<bool>(file);
+}
+
+bool LinearPolicy::load(const std::string& filename, LinearPolicy& policy) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open linear policy: " << filename << std::endl;
+        return false;
+    }
+    LinearPolicyHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "TLP1", 4) != 0) {
+        std::cerr << "Not a linear policy file: " << filename << std::endl;
+        return false;
+    }
+    if (header.version != kLinearPolicyVersion || header.observationSize != kObservationSize ||
+        header.actions != kQActions || header.degree < 1 || header.degree > kMaxLinearDegree) {
+        std::cerr << "Unsupported linear policy in " << filename << std::endl;
+        return false;
+    }
+    LinearPolicy loaded(static_cast<int>(header.degree));
+    if (header.featureCount != static_cast<std::uint32_t>(loaded.featureCount) ||
+        !file.read(reinterpret_cast<char*>(loaded.weights.data()),
+                   static_cast<std::streamsize>(loaded.weights.size() * sizeof(float)))) {
+        std::cerr << "Truncated linear policy: " << filename << std::endl;
+        return false;
+    }
+    policy = std::move(loaded);
+    return true;
+}
+
+bool LinearPolicy::isLinearPolicyFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[4];
+    return file.read(magic, 4) && std::memcmp(magic, "TLP1", 4) == 0;
+}
@@ -0,0 +1,54 @@
+#ifndef LINEARPOLICY_HPP
+#define LINEARPOLICY_HPP
+
+#include "QFunction.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Highest polynomial degree supported; C(kObservationSize + 6, 6) = 1716 features.
+constexpr int kMaxLinearDegree = 6;
+
+// Header of a linear policy file, followed by the weights as floats,
+// kQActions rows of featureCount.
+struct LinearPolicyHeader {
+    char magic[4];                  // "TLP1"
+    std::uint32_t version;
+    std::uint32_t observationSize;  // kObservationSize when written.
+    std::uint32_t actions;
+    std::uint32_t degree;
+    std::uint32_t featureCount;
+    std::uint8_t reserved[8];       // Pads the header to 32 bytes.
+};
+static_assert(sizeof(LinearPolicyHeader) == 32, "Linear policy header must stay 32 bytes");
+
+// Linear action values over polynomial features: every monomial of the
+// observation up to the policy's degree, constant term first. Each degree's
+// monomials are the previous degree's scaled by one observation entry, so
+// feature extraction is a series of contiguous scale kernels, and each action
+// value one dot product (see SimdKernels.hpp).
+class LinearPolicy : public QFunction {
+public:
+    explicit LinearPolicy(int degree = 2);
+
+    int getDegree() const { return degree; }
+    int getFeatureCount() const { return featureCount; }
+
+    // Writes getFeatureCount() features of an observation to out.
+    void features(const float* observation, float* out) const;
+    void evaluate(const float* observation, float* qValues) const override;
+    // Semi-gradient step on one action: its weights move by step * features,
+    // where step is the learning rate times the TD error.
+    void update(const float* featureValues, int action, float step);
+
+    bool save(const std::string& filename) const;
+    static bool load(const std::string& filename, LinearPolicy& policy);
+    static bool isLinearPolicyFile(const std::string& filename);
+
+private:
+    int degree;
+    int featureCount;
+    std::vector<float> weights;  // [action][feature]
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Memory mapping of a whole file (mmap, or a file mapping on Windows).
+// The contents are paged in on demand and shared with every other process that
+// maps the same file, so large binary tables are used in place without a copy.
+class MappedFile {
+public:
+    // Read-only mapping of an existing file.
+    explicit MappedFile(const std::string& filename);
+    // Writable shared mapping of exactly size bytes, creating the file or
+    // resizing it as needed (new bytes read as zero). Writes reach the file.
+    MappedFile(const std::string& filename, size_t size);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return bytes != nullptr; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+    // Null for read-only mappings.
+    char* mutableData() const { return writable ? const_cast<char*>(bytes) : nullptr; }
+    // Asks the OS to write dirty pages back now (they are written eventually anyway).
+    void flush() const;
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool writable = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+#endif
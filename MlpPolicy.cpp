@@ -0,0 +1,212 @@
+#include "MlpPolicy.hpp"
+#include "SimdKernels.hpp"
+#include "SimRng.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const std::uint32_t kMlpVersion = 1;
+
+MlpPolicy::MlpPolicy(const std::vector<int>& hidden, std::uint64_t seed) {
+    std::vector<int> widths;
+    widths.push_back(kObservationSize);
+    for (int width : hidden) {
+        if (static_cast<int>(widths.size()) < kMaxMlpLayers) {
+            widths.push_back(std::clamp(width, 1, kMaxMlpWidth));
+        }
+    }
+    widths.push_back(kQActions);
+
+    SimRng rng(seed);
+    for (size_t l = 0; l + 1 < widths.size(); ++l) {
+        Layer layer;
+        layer.inputs = widths[l];
+        layer.outputs = widths[l + 1];
+        layer.weights.resize(static_cast<size_t>(layer.inputs) * layer.outputs);
+        layer.bias.assign(layer.outputs, 0.f);
+        // He-uniform: variance 2 / fan-in, suited to ReLU.
+        float limit = std::sqrt(6.f / layer.inputs);
+        for (float& w : layer.weights) {
+            w = (2.f * rng.nextFloat() - 1.f) * limit;
+        }
+        layers.push_back(std::move(layer));
+    }
+}
+
+size_t MlpPolicy::getParameterCount() const {
+    size_t count = 0;
+    for (const Layer& layer : layers) {
+        count += layer.weights.size() + layer.bias.size();
+    }
+    return count;
+}
+
+void MlpPolicy::forward(const float* observation, float activations[][kMaxMlpWidth]) const {
+    const float* input = observation;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        const Layer& layer = layers[l];
+        float* out = activations[l];
+        simd::vecmat(input, layer.weights.data(), layer.inputs, layer.outputs, out);
+        bool hidden = l + 1 < layers.size();
+        for (int r = 0; r < layer.outputs; ++r) {
+            float z = out[r] + layer.bias[r];
+            out[r] = hidden ? std::max(z, 0.f) : z;
+        }
+        input = out;
+    }
+}
+
+void MlpPolicy::evaluate(const float* observation, float* qValues) const {
+    float activations[kMaxMlpLayers][kMaxMlpWidth];
+    forward(observation, activations);
+    std::copy(activations[layers.size() - 1], activations[layers.size() - 1] + kQActions, qValues);
+}
+
+void MlpPolicy::evaluateBatch(const float* observations, int count, float* qValues) const {
+    // Chunks bound the activation buffers on the stack.
+    const int kChunk = 16;
+    float buffers[2][kChunk * kMaxMlpWidth];
+    for (int begin = 0; begin < count; begin += kChunk) {
+        int rows = std::min(kChunk, count - begin);
+        const float* input = observations + static_cast<size_t>(begin) * kObservationSize;
+        for (size_t l = 0; l < layers.size(); ++l) {
+            const Layer& layer = layers[l];
+            bool hidden = l + 1 < layers.size();
+            float* out = hidden ? buffers[l % 2] : qValues + static_cast<size_t>(begin) * kQActions;
+            simd::matmat(input, rows, layer.weights.data(), layer.inputs, layer.outputs, out);
+            for (int i = 0; i < rows; ++i) {
+                float* row = out + static_cast<size_t>(i) * layer.outputs;
+                for (int r = 0; r < layer.outputs; ++r) {
+                    float z = row[r] + layer.bias[r];
+                    row[r] = hidden ? std::max(z, 0.f) : z;
+                }
+            }
+            input = out;
+        }
+    }
+}
+
+float MlpPolicy::train(const float* observations, const int* actions, const float* targets, int count,
+                       float learningRate) {
+    if (count <= 0) {
+        return 0.f;
+    }
+    if (gradients.size() != layers.size()) {
+        gradients = layers;
+    }
+    for (Layer& g : gradients) {
+        std::fill(g.weights.begin(), g.weights.end(), 0.f);
+        std::fill(g.bias.begin(), g.bias.end(), 0.f);
+    }
+
+    int last = static_cast<int>(layers.size()) - 1;
+    float loss = 0.f;
+    float activations[kMaxMlpLayers][kMaxMlpWidth];
+    float delta[kMaxMlpWidth];
+    float previous[kMaxMlpWidth];
+    for (int i = 0; i < count; ++i) {
+        const float* observation = observations + static_cast<size_t>(i) * kObservationSize;
+        forward(observation, activations);
+
+        // Huber loss (threshold 1) on the chosen action only.
+        int action = std::clamp(actions[i], 0, kQActions - 1);
+        float error = activations[last][action] - targets[i];
+        loss += std::fabs(error) <= 1.f ? 0.5f * error * error : std::fabs(error) - 0.5f;
+        std::fill(delta, delta + kQActions, 0.f);
+        delta[action] = std::clamp(error, -1.f, 1.f);
+
+        for (int l = last; l >= 0; --l) {
+            const Layer& layer = layers[l];
+            Layer& grad = gradients[l];
+            const float* input = l > 0 ? activations[l - 1] : observation;
+            simd::axpy(1.f, delta, grad.bias.data(), layer.outputs);
+            for (int k = 0; k < layer.inputs; ++k) {
+                const float* row = &layer.weights[static_cast<size_t>(k) * layer.outputs];
+                // Inputs the ReLU zeroed take no gradient and pass none down.
+                if (input[k] != 0.f) {
+                    simd::axpy(input[k], delta, &grad.weights[static_cast<size_t>(k) * layer.outputs], layer.outputs);
+                }
+                previous[k] = (l > 0 && input[k] > 0.f) ? simd::dot(row, delta, layer.outputs) : 0.f;
+            }
+            if (l > 0) {
+                std::copy(previous, previous + layer.inputs, delta);
+            }
+        }
+    }
+
+    float step = -learningRate / count;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        simd::axpy(step, gradients[l].weights.data(), layers[l].weights.data(),
+                   static_cast<int>(layers[l].weights.size()));
+        simd::axpy(step, gradients[l].bias.data(), layers[l].bias.data(), layers[l].outputs);
+    }
+    return loss / count;
+}
+
+bool MlpPolicy::save(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to write MLP policy: " << filename << std::endl;
+        return false;
+    }
+    MlpFileHeader header{};
+    std::memcpy(header.magic, "TNN1", 4);
+    header.version = kMlpVersion;
+    header.layerCount = static_cast<std::uint32_t>(layers.size());
+    header.widths[0] = kObservationSize;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        header.widths[l + 1] = static_cast<std::uint32_t>(layers[l].outputs);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Layer& layer : layers) {
+        file.write(reinterpret_cast<const char*>(layer.weights.data()),
+                   static_cast<std::streamsize>(layer.weights.size() * sizeof(float)));
+        file.write(reinterpret_cast<const char*>(layer.bias.data()),
+                   static_cast<std::streamsize>(layer.bias.size() * sizeof(float)));
+    }
+    return static_cast<bool>(file);
+}
+
+bool MlpPolicy::load(const std::string& filename, MlpPolicy& policy) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open MLP policy: " << filename << std::endl;
+        return false;
+    }
+    MlpFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "TNN1", 4) != 0) {
+        std::cerr << "Not an MLP policy file: " << filename << std::endl;
+        return false;
+    }
+    bool valid = header.version == kMlpVersion && header.layerCount >= 1 && header.layerCount <= kMaxMlpLayers &&
+                 header.widths[0] == kObservationSize && header.widths[header.layerCount] == kQActions;
+    std::vector<int> hidden;
+    for (std::uint32_t l = 1; valid && l < header.layerCount; ++l) {
+        valid = header.widths[l] >= 1 && header.widths[l] <= kMaxMlpWidth;
+        hidden.push_back(static_cast<int>(header.widths[l]));
+    }
+    if (!valid) {
+        std::cerr << "Unsupported MLP policy in " << filename << std::endl;
+        return false;
+    }
+    MlpPolicy loaded(hidden);
+    for (Layer& layer : loaded.layers) {
+        if (!file.read(reinterpret_cast<char*>(layer.weights.data()),
+                       static_cast<std::streamsize>(layer.weights.size() * sizeof(float))) ||
+            !file.read(reinterpret_cast<char*>(layer.bias.data()),
+                       static_cast<std::streamsize>(layer.bias.size() * sizeof(float)))) {
+            std::cerr << "Truncated MLP policy: " << filename << std::endl;
+            return false;
+        }
+    }
+    policy = std::move(loaded);
+    return true;
+}
+
+bool MlpPolicy::isMlpFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[4];
+    return file.read(magic, 4) && std::memcmp(magic, "TNN1", 4) == 0;
+}
@@ -0,0 +1,65 @@
+#ifndef MLPPOLICY_HPP
+#define MLPPOLICY_HPP
+
+#include "QFunction.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr int kMaxMlpLayers = 4;    // Weight layers, output layer included.
+constexpr int kMaxMlpWidth = 256;   // Widest hidden layer.
+
+// Header of an MLP weight file, followed by each layer's weights (row-major,
+// inputs x outputs) and then its biases, all as floats.
+struct MlpFileHeader {
+    char magic[4];                              // "TNN1"
+    std::uint32_t version;
+    std::uint32_t layerCount;                   // Weight layers.
+    std::uint32_t widths[kMaxMlpLayers + 1];    // Input, hidden..., output widths.
+    std::uint8_t reserved[8];                   // Pads the header to 40 bytes.
+};
+static_assert(sizeof(MlpFileHeader) == 40, "MLP file header must stay 40 bytes");
+
+// Small dense Q-network: the observation through ReLU hidden layers to one
+// linear output per action. Weights are stored input-major, so each layer is
+// a vector-matrix product that broadcasts one input at a time across all
+// outputs (simd::vecmat, AVX2/FMA or scalar). Activations live on the stack,
+// so inference allocates nothing. Trained by minibatch SGD on the
+// Huber loss of the chosen action's value.
+class MlpPolicy : public QFunction {
+public:
+    // Hidden layer widths, e.g. {64, 64}; weights are He-initialised from seed.
+    explicit MlpPolicy(const std::vector<int>& hidden = { 64, 64 }, std::uint64_t seed = 1);
+
+    int getLayerCount() const { return static_cast<int>(layers.size()); }
+    size_t getParameterCount() const;
+
+    void evaluate(const float* observation, float* qValues) const override;
+    // Each layer as one matrix-matrix product over the batch (simd::matmat).
+    void evaluateBatch(const float* observations, int count, float* qValues) const override;
+    // One SGD step on a minibatch: moves Q(observations[i], actions[i]) towards
+    // targets[i]. Observations are count rows of kObservationSize. Returns the
+    // mean loss before the step.
+    float train(const float* observations, const int* actions, const float* targets, int count,
+                float learningRate);
+
+    bool save(const std::string& filename) const;
+    static bool load(const std::string& filename, MlpPolicy& policy);
+    static bool isMlpFile(const std::string& filename);
+
+private:
+    struct Layer {
+        int inputs = 0;
+        int outputs = 0;
+        std::vector<float> weights;  // [input][output]
+        std::vector<float> bias;
+    };
+
+    // Runs the network, keeping each layer's output (after ReLU for hidden layers).
+    void forward(const float* observation, float activations[][kMaxMlpWidth]) const;
+
+    std::vector<Layer> layers;
+    std::vector<Layer> gradients;  // Training scratch, same shapes as layers.
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef MOVEMENTS_HPP
+#define MOVEMENTS_HPP
+
+#include "Vehicle.hpp"
+#include <array>
+#include <cstdint>
+
+// Every approach offers left, straight and right movements.
+// Movement i of approach a has index a * 3 + i and owns bit (1 << index)
+// in the 64-bit masks below, so a permission check is a single AND.
+constexpr int kMovementsPerApproach = 3;
+constexpr int kMovementCount = 4 * kMovementsPerApproach;
+
+constexpr int movementIndex(Direction approach, Movement m) {
+    return static_cast<int>(approach) * kMovementsPerApproach + static_cast<int>(m);
+}
+
+constexpr std::uint64_t movementBit(Direction approach, Movement m) {
+    return std::uint64_t{1} << movementIndex(approach, m);
+}
+
+// All movements of one approach.
+constexpr std::uint64_t approachMask(Direction approach) {
+    return movementBit(approach, Movement::Left) |
+           movementBit(approach, Movement::Straight) |
+           movementBit(approach, Movement::Right);
+}
+
+constexpr bool isVertical(Direction d) {
+    return d == Direction::TopToBottom || d == Direction::BottomToTop;
+}
+
+// Approach facing this one across the intersection.
+constexpr Direction opposingApproach(Direction d) {
+    return static_cast<Direction>(static_cast<int>(d) ^ 1);
+}
+
+// Direction of travel once the movement is complete.
+constexpr Direction exitDirection(Direction approach, Movement m) {
+    if (m == Movement::Straight) return approach;
+    switch (approach) {
+        case Direction::TopToBottom:
+            return m == Movement::Left ? Direction::LeftToRight : Direction::RightToLeft;
+        case Direction::BottomToTop:
+            return m == Movement::Left ? Direction::RightToLeft : Direction::LeftToRight;
+        case Direction::LeftToRight:
+            return m == Movement::Left ? Direction::BottomToTop : Direction::TopToBottom;
+        case Direction::RightToLeft:
+        default:
+            return m == Movement::Left ? Direction::TopToBottom : Direction::BottomToTop;
+    }
+}
+
+// Two movements conflict when their paths cross and neither can be served
+// while the other runs. Movements from perpendicular approaches always cross
+// on this intersection's lane layout. A left turn against the opposing flow
+// is not a hard conflict but a permissive one (see movementYields).
+constexpr bool movementsConflict(int i, int j) {
+    return isVertical(static_cast<Direction>(i / kMovementsPerApproach)) !=
+           isVertical(static_cast<Direction>(j / kMovementsPerApproach));
+}
+
+// Movement i yields to movement j when both may run in the same phase but i
+// only enters the junction through gaps in j: a left turn yields to the
+// opposing approach's through and right-turn traffic, whose paths it crosses
+// or merges into.
+constexpr bool movementYields(int i, int j) {
+    Direction approach = static_cast<Direction>(i / kMovementsPerApproach);
+    return static_cast<Movement>(i % kMovementsPerApproach) == Movement::Left &&
+           static_cast<Direction>(j / kMovementsPerApproach) == opposingApproach(approach) &&
+           static_cast<Movement>(j % kMovementsPerApproach) != Movement::Left;
+}
+
+template <typename Relation>
+constexpr std::array<std::uint64_t, kMovementCount> buildMovementMatrix(Relation related) {
+    std::array<std::uint64_t, kMovementCount> m{};
+    for (int i = 0; i < kMovementCount; ++i) {
+        for (int j = 0; j < kMovementCount; ++j) {
+            if (related(i, j)) {
+                m[i] |= std::uint64_t{1} << j;
+            }
+        }
+    }
+    return m;
+}
+
+// kConflictMatrix[i] has bit j set when movement j may not run alongside movement i.
+constexpr std::array<std::uint64_t, kMovementCount> kConflictMatrix = buildMovementMatrix(movementsConflict);
+// kYieldMatrix[i] has bit j set when movement i must wait for a gap in movement j.
+constexpr std::array<std::uint64_t, kMovementCount> kYieldMatrix = buildMovementMatrix(movementYields);
+
+// Movements that yield to at least one other.
+constexpr std::uint64_t yieldingMovements() {
+    std::uint64_t mask = 0;
+    for (int i = 0; i < kMovementCount; ++i) {
+        if (kYieldMatrix[i]) mask |= std::uint64_t{1} << i;
+    }
+    return mask;
+}
+
+// True when no two movements in the mask conflict with each other.
+constexpr bool isConflictFree(std::uint64_t mask) {
+    for (int i = 0; i < kMovementCount; ++i) {
+        if ((mask >> i & 1) && (kConflictMatrix[i] & mask)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
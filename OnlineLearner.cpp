@@ -0,0 +1,118 @@
+#include "OnlineLearner.hpp"
+#include "QTableLoader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+OnlineLearner::OnlineLearner(const DenseQTable& initial, const OnlineLearnerSettings& learnerSettings)
+    : settings(learnerSettings),
+      table(std::max(learnerSettings.maxQueue, 0) + 1, std::max(learnerSettings.maxQueue, 0) + 1)
+{
+    settings.publishEvery = std::max(settings.publishEvery, 1);
+    for (int ns = 0; ns < std::min(table.nsStates(), initial.nsStates()); ++ns) {
+        for (int ew = 0; ew < std::min(table.ewStates(), initial.ewStates()); ++ew) {
+            const double* values = initial.values(ns, ew);
+            std::copy(values, values + kQActions, table.mutableValues(ns, ew));
+        }
+    }
+    published = std::make_shared<const DenseQTable>(table);
+    worker = std::thread(&OnlineLearner::run, this);
+}
+
+OnlineLearner::~OnlineLearner() {
+    stopping.store(true, std::memory_order_release);
+    worker.join();
+}
+
+bool OnlineLearner::push(const Transition& transition) {
+    if (!queue.push(transition)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const DenseQTable> OnlineLearner::policy() const {
+    return std::atomic_load(&published);
+}
+
+void OnlineLearner::update(const Transition& t) {
+    // Unseen states start at zero, as in traffic_train.
+    auto row = [this](int ns, int ew) {
+        double* q = table.mutableValues(std::clamp(ns, 0, table.nsStates() - 1),
+                                        std::clamp(ew, 0, table.ewStates() - 1));
+        if (!DenseQTable::isKnown(q)) {
+            std::fill(q, q + kQActions, 0.0);
+        }
+        return q;
+    };
+    double* q = row(t.stateNS, t.stateEW);
+    const double* next = row(t.nextNS, t.nextEW);
+    double target = t.reward + settings.gamma * std::max({ next[0], next[1], next[2] });
+    int action = std::clamp(t.action, 0, kQActions - 1);
+    q[action] += settings.alpha * (target - q[action]);
+}
+
+void OnlineLearner::publish() {
+    std::atomic_store(&published, std::make_shared<const DenseQTable>(table));
+}
+
+bool OnlineLearner::writeSnapshot() const {
+    const std::string& path = settings.snapshotPath;
+    std::string temp = path + ".tmp";
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    bool saved = json ? QTableLoader::saveQTable(table.toQTable(), temp)
+                      : QTableLoader::savePolicyFile(table, temp);
+    if (!saved) {
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void OnlineLearner::run() {
+    using Clock = std::chrono::steady_clock;
+    auto lastSnapshot = Clock::now();
+    long long sincePublish = 0;
+    bool dirty = false;
+    Transition t;
+    for (;;) {
+        bool draining = stopping.load(std::memory_order_acquire);
+        bool any = false;
+        while (queue.pop(t)) {
+            update(t);
+            any = dirty = true;
+            updates.fetch_add(1, std::memory_order_relaxed);
+            if (++sincePublish >= settings.publishEvery) {
+                publish();
+                sincePublish = 0;
+            }
+        }
+        if (draining) {
+            break;
+        }
+        if (dirty && !settings.snapshotPath.empty() &&
+            std::chrono::duration<float>(Clock::now() - lastSnapshot).count() >= settings.snapshotSeconds) {
+            writeSnapshot();
+            lastSnapshot = Clock::now();
+            dirty = false;
+        }
+        if (!any) {
+            // Decisions are seconds of simulated time apart; polling is cheap enough.
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    if (sincePublish > 0) {
+        publish();
+    }
+    if (!settings.snapshotPath.empty() && writeSnapshot()) {
+        std::cout << "Wrote learned policy to " << settings.snapshotPath << std::endl;
+    }
+}
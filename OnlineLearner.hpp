@@ -0,0 +1,70 @@
+#ifndef ONLINELEARNER_HPP
+#define ONLINELEARNER_HPP
+
+#include "DenseQTable.hpp"
+#include "SpscQueue.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+// One observed decision: the state and action of a decision, the reward the
+// next decision measured for it, and the state found there.
+struct Transition {
+    int stateNS, stateEW;
+    int action;
+    double reward;
+    int nextNS, nextEW;
+};
+
+struct OnlineLearnerSettings {
+    double alpha = 0.1;
+    double gamma = 0.95;
+    int maxQueue = 64;           // The table covers queues 0..maxQueue; longer ones are clamped.
+    int publishEvery = 32;       // Updates between policy snapshots handed to the simulation.
+    float snapshotSeconds = 60.f;  // Wall-clock seconds between snapshots written to disk.
+    std::string snapshotPath;    // .json or binary policy file; empty writes none.
+};
+
+// Online Q-learning for a running simulation. The simulation pushes one
+// Transition per phase-end decision into a lock-free queue and carries on; a
+// learner thread applies the TD updates to its own table, periodically
+// publishes a copy for the simulation to act on, and writes snapshots to disk
+// (atomically replaced, so a watcher never sees half a file). A full queue
+// drops the transition rather than stall the decision.
+//
+// The queue has a single producer, so a learner serves one simulation.
+class OnlineLearner {
+public:
+    OnlineLearner(const DenseQTable& initial, const OnlineLearnerSettings& settings);
+    // Applies what is still queued and writes a final snapshot.
+    ~OnlineLearner();
+
+    OnlineLearner(const OnlineLearner&) = delete;
+    OnlineLearner& operator=(const OnlineLearner&) = delete;
+
+    // Producer side; never blocks. False if the transition was dropped.
+    bool push(const Transition& transition);
+    // The latest published table.
+    std::shared_ptr<const DenseQTable> policy() const;
+
+    long long getUpdates() const { return updates.load(std::memory_order_relaxed); }
+    long long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void update(const Transition& t);
+    void publish();
+    bool writeSnapshot() const;
+
+    OnlineLearnerSettings settings;
+    DenseQTable table;                                // Owned by the learner thread.
+    std::shared_ptr<const DenseQTable> published;     // Accessed with std::atomic_load/store.
+    SpscQueue<Transition, 4096> queue;
+    std::atomic<bool> stopping{false};
+    std::atomic<long long> updates{0};
+    std::atomic<long long> dropped{0};
+    std::thread worker;
+};
+
+#endif
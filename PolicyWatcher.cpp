@@ -0,0 +1,105 @@
+#include "PolicyWatcher.hpp"
+#include "QTableLoader.hpp"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How often the thread checks for a stop request (and, without inotify, for changes).
+static const int kPollMilliseconds = 250;
+
+PolicyWatcher::PolicyWatcher(const std::string& policyPath, std::shared_ptr<const DenseQTable> initial)
+    : path(policyPath),
+      current(initial && initial->nsStates() > 0 ? std::make_shared<const DenseQTable>(initial->detached())
+                                                  : std::move(initial))
+{
+    worker = std::thread(&PolicyWatcher::run, this);
+}
+
+PolicyWatcher::~PolicyWatcher() {
+    stopping.store(true, std::memory_order_release);
+    worker.join();
+}
+
+std::shared_ptr<const DenseQTable> PolicyWatcher::policy() const {
+    return std::atomic_load(&current);
+}
+
+void PolicyWatcher::reload() {
+    // Only a complete load replaces the policy: a policy file must pass its
+    // checksum and JSON must parse to the end, so a half-written or corrupt file
+    // is rejected here (the loaders report why). The values are copied out of
+    // the mapping: truncating a mapped file under its readers would crash them.
+    DenseQTable loaded;
+    if (!QTableLoader::loadDenseQTable(path, loaded) || loaded.nsStates() == 0 || loaded.ewStates() == 0) {
+        std::cerr << "Keeping the current policy; " << path << " did not load" << std::endl;
+        return;
+    }
+    auto table = std::make_shared<const DenseQTable>(loaded.detached());
+    std::atomic_store(&current, std::shared_ptr<const DenseQTable>(std::move(table)));
+    // Reported through getReloads(): printing from this thread would interleave
+    // with the simulation's own output.
+    reloads.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef __linux__
+
+void PolicyWatcher::run() {
+    std::filesystem::path file(path);
+    std::string directory = file.has_parent_path() ? file.parent_path().string() : ".";
+    std::string name = file.filename().string();
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "Cannot watch " << directory << " for policy changes" << std::endl;
+        if (fd >= 0) close(fd);
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (!stopping.load(std::memory_order_acquire)) {
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, kPollMilliseconds) <= 0) {
+            continue;
+        }
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len > 0 && name == event->name) {
+                    changed = true;
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (changed) {
+            reload();
+        }
+    }
+    close(fd);
+}
+
+#else
+
+void PolicyWatcher::run() {
+    std::error_code error;
+    auto lastWrite = std::filesystem::last_write_time(path, error);
+    while (!stopping.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kPollMilliseconds));
+        auto write = std::filesystem::last_write_time(path, error);
+        if (!error && write != lastWrite) {
+            lastWrite = write;
+            reload();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef POLICYWATCHER_HPP
+#define POLICYWATCHER_HPP
+
+#include "DenseQTable.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Reloads a policy file (JSON or binary) whenever it changes on disk. A
+// background thread waits for changes (inotify on Linux, modification-time
+// polling elsewhere), loads and validates the new table, and publishes it with
+// an atomic pointer swap; a file that fails to load leaves the current policy
+// in place. Readers hold the table they fetched through its shared_ptr, so a
+// replaced table is freed only once the last of them lets go.
+//
+// Tables are held in memory rather than mapped, so the file may be rewritten
+// in place as well as replaced by renaming a temporary over it; the directory
+// is watched rather than the file so that renames are seen too.
+class PolicyWatcher {
+public:
+    PolicyWatcher(const std::string& path, std::shared_ptr<const DenseQTable> initial);
+    ~PolicyWatcher();
+
+    PolicyWatcher(const PolicyWatcher&) = delete;
+    PolicyWatcher& operator=(const PolicyWatcher&) = delete;
+
+    // The latest valid table.
+    std::shared_ptr<const DenseQTable> policy() const;
+    int getReloads() const { return reloads.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void reload();
+
+    std::string path;
+    std::shared_ptr<const DenseQTable> current;  // Accessed with std::atomic_load/store.
+    std::atomic<bool> stopping{false};
+    std::atomic<int> reloads{0};
+    std::thread worker;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef QFUNCTION_HPP
+#define QFUNCTION_HPP
+
+#include "DenseQTable.hpp"
+
+// Observation of a phase-end decision for function-approximation policies.
+// It is wider than the (queueNS, queueEW) table key, and each entry is scaled
+// to roughly [0, 1] (see TrafficManager::getObservation).
+enum ObservationIndex {
+    ObsQueueNS,       // Measured queues / kObservationQueueScale.
+    ObsQueueEW,
+    ObsEmaNS,         // Queue EMAs / kObservationQueueScale.
+    ObsEmaEW,
+    ObsGreenTime,     // Current green time / kObservationGreenScale.
+    ObsPhaseNS,       // 1 when the NS green is ending, 0 for EW.
+    ObsArrivalRate,   // Vehicles arriving per second / kObservationRateScale.
+    kObservationSize
+};
+constexpr float kObservationQueueScale = 20.f;
+constexpr float kObservationGreenScale = 10.f;
+constexpr float kObservationRateScale = 2.5f;  // A spawn every 0.4 s, the trainers' busiest.
+
+// Action-value function over observations, as an alternative to the Q-table.
+class QFunction {
+public:
+    virtual ~QFunction() = default;
+
+    // The kQActions values of one observation of kObservationSize floats.
+    virtual void evaluate(const float* observation, float* qValues) const = 0;
+    // Values of count observations (rows of kObservationSize) into count rows
+    // of kQActions. Backends that can share work across a batch override this.
+    virtual void evaluateBatch(const float* observations, int count, float* qValues) const {
+        for (int i = 0; i < count; ++i) {
+            evaluate(observations + static_cast<long>(i) * kObservationSize, qValues + static_cast<long>(i) * kQActions);
+        }
+    }
+
+    // Greedy action; ties go to the lower action, as with DenseQTable::argmax.
+    int greedy(const float* observation) const {
+        float q[kQActions];
+        evaluate(observation, q);
+        int best = q[1] > q[0] ? 1 : 0;
+        return q[2] > q[best] ? 2 : best;
+    }
+};
+
+#endif
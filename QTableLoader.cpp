@@ -1,20 +1,381 @@
 #include "QTableLoader.hpp"
+#include "Checksum.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 
-QTable QTableLoader::loadQTable(const std::string& filename) {
+namespace {
+
+constexpr std::uint32_t kPolicyVersion = 1;
+
+struct StateEntry {
+    int ns;
+    int ew;
+    double q[kQActions];
+};
+
+// Streaming parser for the q_table.json layout, {"(ns, ew)": [q0, q1, q2], ...}.
+// It walks the text in place and hands every state to a callback, parsing the
+// tuple key and the numbers directly, so no strings or DOM nodes are built.
+// Python's NaN / Infinity literals are accepted as values.
+class QTableJsonParser {
+public:
+    QTableJsonParser(const char* begin, const char* end) : start(begin), p(begin), end(end) {}
+
+    template <typename OnEntry>
+    bool parse(OnEntry onEntry) {
+        skipSpace();
+        if (!expect('{')) return false;
+        skipSpace();
+        if (p < end && *p == '}') {
+            ++p;
+            return true;
+        }
+        for (;;) {
+            StateEntry entry{};
+            skipSpace();
+            if (!expect('"')) return false;
+            skipSpace();
+            if (!expect('(')) return false;
+            skipSpace();
+            if (!parseInt(entry.ns)) return false;
+            skipSpace();
+            if (!expect(',')) return false;
+            skipSpace();
+            if (!parseInt(entry.ew)) return false;
+            skipSpace();
+            if (!expect(')')) return false;
+            skipSpace();
+            if (!expect('"')) return false;
+            skipSpace();
+            if (!expect(':')) return false;
+            skipSpace();
+            if (!expect('[')) return false;
+
+            int count = 0;
+            skipSpace();
+            if (p < end && *p == ']') {
+                ++p;
+            } else {
+                for (;;) {
+                    double value;
+                    skipSpace();
+                    if (!parseNumber(value)) return false;
+                    if (count < kQActions) entry.q[count] = value;
+                    ++count;
+                    skipSpace();
+                    if (p < end && *p == ',') {
+                        ++p;
+                        continue;
+                    }
+                    if (!expect(']')) return false;
+                    break;
+                }
+            }
+            if (entry.ns < 0 || entry.ew < 0 || entry.ns > kMaxQueueState || entry.ew > kMaxQueueState) {
+                std::cerr << "Skipping Q-table state (" << entry.ns << ", " << entry.ew << "): queues must be in [0, "
+                          << kMaxQueueState << "]" << std::endl;
+            } else if (count == kQActions) {
+                onEntry(entry);
+            } else {
+                std::cerr << "Skipping Q-table state (" << entry.ns << ", " << entry.ew << "): expected "
+                          << kQActions << " action values" << std::endl;
+            }
+
+            skipSpace();
+            if (p < end && *p == ',') {
+                ++p;
+                continue;
+            }
+            return expect('}');
+        }
+    }
+
+    size_t offset() const { return static_cast<size_t>(p - start); }
+
+private:
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+    }
+    bool expect(char c) {
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+    bool matchLiteral(const char* literal) {
+        size_t n = std::strlen(literal);
+        if (static_cast<size_t>(end - p) >= n && std::memcmp(p, literal, n) == 0) {
+            p += n;
+            return true;
+        }
+        return false;
+    }
+    bool parseInt(int& out) {
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc()) return false;
+        p = result.ptr;
+        return true;
+    }
+    bool parseNumber(double& out) {
+        if (matchLiteral("NaN")) {
+            out = std::numeric_limits<double>::quiet_NaN();
+            return true;
+        }
+        if (matchLiteral("Infinity")) {
+            out = std::numeric_limits<double>::infinity();
+            return true;
+        }
+        if (matchLiteral("-Infinity")) {
+            out = -std::numeric_limits<double>::infinity();
+            return true;
+        }
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc()) return false;
+        p = result.ptr;
+        return true;
+    }
+
+    const char* start;
+    const char* p;
+    const char* end;
+};
+
+// Maps a JSON Q-table and streams its states to onEntry, filling in stats.
+template <typename OnEntry>
+bool streamQTableJson(const std::string& filename, QTableLoadStats* stats, OnEntry onEntry) {
+    auto startTime = std::chrono::steady_clock::now();
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        std::cerr << "Unable to open Q-table file: " << filename << std::endl;
+        return false;
+    }
+    QTableJsonParser parser(file.data(), file.data() + file.size());
+    size_t states = 0;
+    bool ok = parser.parse([&](const StateEntry& entry) {
+        onEntry(entry);
+        ++states;
+    });
+    if (!ok) {
+        std::cerr << "Q-table parse error in " << filename << " at byte " << parser.offset() << std::endl;
+    }
+    if (stats) {
+        stats->bytes = file.size();
+        stats->states = ok ? states : 0;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+    return ok;
+}
+
+}  // namespace
+
+QTable QTableLoader::loadQTable(const std::string& filename, QTableLoadStats* stats) {
     QTable table;
-    std::ifstream file(filename);
+    bool ok = streamQTableJson(filename, stats, [&](const StateEntry& entry) {
+        table["(" + std::to_string(entry.ns) + ", " + std::to_string(entry.ew) + ")"] =
+            std::vector<double>(entry.q, entry.q + kQActions);
+    });
+    // A truncated or malformed file yields no table rather than part of one.
+    return ok ? table : QTable();
+}
+
+DenseQTable QTableLoader::loadDenseQTableJson(const std::string& filename, QTableLoadStats* stats) {
+    DenseQTable table;
+    loadDenseQTableJson(filename, table, stats);
+    return table;
+}
+
+bool QTableLoader::loadDenseQTableJson(const std::string& filename, DenseQTable& table, QTableLoadStats* stats) {
+    // States arrive in any order, so they are gathered (compactly) until the
+    // table's bounds are known, then scattered into the dense array.
+    std::vector<StateEntry> entries;
+    int nsMax = -1;
+    int ewMax = -1;
+    bool ok = streamQTableJson(filename, stats, [&](const StateEntry& entry) {
+        entries.push_back(entry);
+        nsMax = std::max(nsMax, entry.ns);
+        ewMax = std::max(ewMax, entry.ew);
+    });
+    if (!ok) {
+        // A truncated or malformed file yields no table rather than part of one.
+        return false;
+    }
+    DenseQTable loaded(nsMax + 1, ewMax + 1);
+    for (const StateEntry& entry : entries) {
+        std::copy(entry.q, entry.q + kQActions, loaded.mutableValues(entry.ns, entry.ew));
+    }
+    table = std::move(loaded);
+    return true;
+}
+
+bool QTableLoader::saveQTable(const QTable& table, const std::string& filename) {
+    std::ofstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "Unable to open Q-table file: " << filename << std::endl;
-        return table;
+        std::cerr << "Unable to write Q-table file: " << filename << std::endl;
+        return false;
     }
-    nlohmann::json j;
-    file >> j;
-    // Convert each key-value pair from JSON into the QTable.
-    for (auto it = j.begin(); it != j.end(); ++it) {
-        // it.key() is a string key (e.g., "(1, 5)") and it.value() is an array of numbers.
-        table[it.key()] = it.value().get<std::vector<double>>();
+    nlohmann::json j = nlohmann::json::object();
+    for (const auto& entry : table) {
+        j[entry.first] = entry.second;
     }
+    file << j.dump();
+    return static_cast<bool>(file);
+}
+
+DenseQTable QTableLoader::loadDenseQTable(const std::string& filename, QTableLoadStats* stats) {
+    DenseQTable table;
+    loadDenseQTable(filename, table, stats);
     return table;
 }
+
+bool QTableLoader::loadDenseQTable(const std::string& filename, DenseQTable& table, QTableLoadStats* stats) {
+    if (isPolicyFile(filename)) {
+        return loadPolicyFile(filename, table);
+    }
+    return loadDenseQTableJson(filename, table, stats);
+}
+
+bool QTableLoader::isPolicyFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[4] = {};
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, "TQP1", 4) == 0;
+}
+
+bool QTableLoader::isQuantizedPolicyFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    PolicyFileHeader header{};
+    return file.read(reinterpret_cast<char*>(&header), sizeof(header)) && std::memcmp(header.magic, "TQP1", 4) == 0 &&
+           header.dtype != static_cast<std::uint32_t>(PolicyDType::Float64);
+}
+
+// Maps a policy file of any value type and validates its header, size and
+// checksum. Returns null (after reporting why) if it cannot be used.
+static std::shared_ptr<const MappedFile> mapPolicyFile(const std::string& filename, PolicyFileHeader& header) {
+    auto mapping = std::make_shared<const MappedFile>(filename);
+    if (!mapping->isOpen()) {
+        std::cerr << "Unable to map policy file: " << filename << std::endl;
+        return nullptr;
+    }
+    if (mapping->size() < sizeof(header)) {
+        std::cerr << "Policy file is truncated: " << filename << std::endl;
+        return nullptr;
+    }
+    std::memcpy(&header, mapping->data(), sizeof(header));
+    size_t valueBytes = 0;
+    std::uint64_t rowWidth = kQuantizedStride;
+    switch (static_cast<PolicyDType>(header.dtype)) {
+    case PolicyDType::Float64: valueBytes = sizeof(double); rowWidth = kQActions; break;
+    case PolicyDType::Int8: valueBytes = 1; break;
+    case PolicyDType::Float16: valueBytes = 2; break;
+    }
+    std::uint64_t expected = (static_cast<std::uint64_t>(header.nsStates) * header.ewStates + 1) * rowWidth;
+    if (std::memcmp(header.magic, "TQP1", 4) != 0 || header.version != kPolicyVersion || valueBytes == 0 ||
+        header.actions != static_cast<std::uint32_t>(kQActions) || header.valueCount != expected ||
+        mapping->size() != sizeof(header) + expected * valueBytes) {
+        std::cerr << "Policy file is not compatible with this build: " << filename << std::endl;
+        return nullptr;
+    }
+    if (fnv1a64(mapping->data() + sizeof(header), expected * valueBytes) != header.checksum) {
+        std::cerr << "Policy file checksum mismatch: " << filename << std::endl;
+        return nullptr;
+    }
+    return mapping;
+}
+
+bool QTableLoader::loadPolicyFile(const std::string& filename, DenseQTable& table) {
+    PolicyFileHeader header{};
+    auto mapping = mapPolicyFile(filename, header);
+    if (!mapping) {
+        return false;
+    }
+    const char* values = mapping->data() + sizeof(header);
+    if (header.dtype != static_cast<std::uint32_t>(PolicyDType::Float64)) {
+        table = QuantizedQTable(static_cast<int>(header.nsStates), static_cast<int>(header.ewStates),
+                                static_cast<PolicyDType>(header.dtype), header.scale, header.offset, mapping, values)
+                    .dequantized();
+        return true;
+    }
+    table = DenseQTable(static_cast<int>(header.nsStates), static_cast<int>(header.ewStates), mapping,
+                        reinterpret_cast<const double*>(values));
+    return true;
+}
+
+bool QTableLoader::loadQuantizedPolicyFile(const std::string& filename, QuantizedQTable& table) {
+    PolicyFileHeader header{};
+    auto mapping = mapPolicyFile(filename, header);
+    if (!mapping) {
+        return false;
+    }
+    if (header.dtype == static_cast<std::uint32_t>(PolicyDType::Float64)) {
+        std::cerr << "Policy file is not quantized: " << filename << std::endl;
+        return false;
+    }
+    const char* codes = mapping->data() + sizeof(header);
+    table = QuantizedQTable(static_cast<int>(header.nsStates), static_cast<int>(header.ewStates),
+                            static_cast<PolicyDType>(header.dtype), header.scale, header.offset, mapping, codes);
+    return true;
+}
+
+// Writes the header and values of a policy file of any value type. The file
+// is written beside the target and renamed over it, so processes that have
+// the old file mapped keep reading it intact instead of seeing it truncated.
+static bool writePolicyFile(const std::string& filename, PolicyFileHeader& header, const char* values, size_t bytes) {
+    std::string temp = filename + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Unable to write policy file: " << temp << std::endl;
+            return false;
+        }
+        std::memcpy(header.magic, "TQP1", 4);
+        header.version = kPolicyVersion;
+        header.actions = kQActions;
+        header.checksum = fnv1a64(values, bytes);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(values, static_cast<std::streamsize>(bytes));
+        if (!file.flush()) {
+            std::cerr << "Unable to write policy file: " << temp << std::endl;
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(filename.c_str());
+#endif
+    if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Unable to replace policy file: " << filename << std::endl;
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool QTableLoader::savePolicyFile(const DenseQTable& table, const std::string& filename) {
+    PolicyFileHeader header{};
+    header.dtype = static_cast<std::uint32_t>(PolicyDType::Float64);
+    header.nsStates = static_cast<std::uint32_t>(table.nsStates());
+    header.ewStates = static_cast<std::uint32_t>(table.ewStates());
+    header.valueCount = table.valueCount();
+    header.scale = 1.0;
+    return writePolicyFile(filename, header, reinterpret_cast<const char*>(table.data()),
+                           table.valueCount() * sizeof(double));
+}
+
+bool QTableLoader::savePolicyFile(const QuantizedQTable& table, const std::string& filename) {
+    PolicyFileHeader header{};
+    header.dtype = static_cast<std::uint32_t>(table.dtype());
+    header.nsStates = static_cast<std::uint32_t>(table.nsStates());
+    header.ewStates = static_cast<std::uint32_t>(table.ewStates());
+    header.valueCount = table.codeCount();
+    header.scale = table.scale();
+    header.offset = table.offset();
+    return writePolicyFile(filename, header, static_cast<const char*>(table.data()), table.byteCount());
+}
@@ -5,14 +5,68 @@
 #include <unordered_map>
 #include <vector>
 #include "json.hpp"  
+#include "DenseQTable.hpp"
+#include "QuantizedQTable.hpp"
+#include <cstdint>
 
-// Define QTable as an unordered_map with string keys and vector<double> values.
-using QTable = std::unordered_map<std::string, std::vector<double>>;
+// Header of the binary policy format. It is followed by the DenseQTable values
+// (Float64) or QuantizedQTable codes (Int8, Float16), sentinel row included, so
+// a mapped file is used in place.
+struct PolicyFileHeader {
+    char magic[4];              // "TQP1"
+    std::uint32_t version;
+    std::uint32_t dtype;        // PolicyDType
+    std::uint32_t actions;
+    std::uint32_t nsStates;
+    std::uint32_t ewStates;
+    std::uint64_t valueCount;   // (nsStates * ewStates + 1) * actions, or * kQuantizedStride when quantized.
+    std::uint64_t checksum;     // FNV-1a 64 of the value bytes.
+    double scale;               // Quantized tables decode as code * scale + offset.
+    double offset;
+    std::uint8_t reserved[8];   // Pads the header to 64 bytes to keep the values aligned.
+};
+static_assert(sizeof(PolicyFileHeader) == 64, "Policy file header must stay 64 bytes");
+
+// What a JSON load read and how fast.
+struct QTableLoadStats {
+    size_t bytes = 0;
+    size_t states = 0;
+    double seconds = 0.0;
+
+    double megabytesPerSecond() const { return seconds > 0.0 ? bytes / seconds / 1e6 : 0.0; }
+};
 
+// JSON Q-tables are parsed by a streaming tokenizer over the mapped file, which
+// reads the "(ns, ew)" keys and values straight into the destination table.
+// Memory during a load is proportional to the table, not to the text. A file
+// that does not parse to the end loads as an empty table, and states with a
+// queue above kMaxQueueState are skipped.
 class QTableLoader {
 public:
     // Loads the Q-table from a JSON file.
-    static QTable loadQTable(const std::string& filename);
+    static QTable loadQTable(const std::string& filename, QTableLoadStats* stats = nullptr);
+    static bool saveQTable(const QTable& table, const std::string& filename);
+
+    // Loads either format into the dense table the controller uses: a binary
+    // policy file (detected from its magic) is mapped, JSON is parsed directly into it.
+    // The bool forms report whether the file loaded in full and leave table
+    // untouched when it did not; the others return an empty table instead.
+    static DenseQTable loadDenseQTable(const std::string& filename, QTableLoadStats* stats = nullptr);
+    static bool loadDenseQTable(const std::string& filename, DenseQTable& table, QTableLoadStats* stats = nullptr);
+    static DenseQTable loadDenseQTableJson(const std::string& filename, QTableLoadStats* stats = nullptr);
+    static bool loadDenseQTableJson(const std::string& filename, DenseQTable& table, QTableLoadStats* stats = nullptr);
+
+    // Binary policy files. Loading maps the file and validates its header and
+    // checksum; the returned table reads the mapping in place. A quantized file
+    // loads into a DenseQTable decoded into memory.
+    static bool loadPolicyFile(const std::string& filename, DenseQTable& table);
+    static bool savePolicyFile(const DenseQTable& table, const std::string& filename);
+    static bool isPolicyFile(const std::string& filename);
+
+    // Quantized policy files (int8 or fp16 codes), read in place like Float64 ones.
+    static bool loadQuantizedPolicyFile(const std::string& filename, QuantizedQTable& table);
+    static bool savePolicyFile(const QuantizedQTable& table, const std::string& filename);
+    static bool isQuantizedPolicyFile(const std::string& filename);
 };
 
 #endif 
@@ -0,0 +1,215 @@
+#include "QuantizedQTable.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include "MappedFile.hpp"
+
+static const std::uint16_t kHalfUnknown = 0x7E00;  // Quiet NaN.
+
+QuantizedQTable::QuantizedQTable()
+    : nsCount(0),
+      ewCount(0),
+      type(PolicyDType::Int8),
+      scaleFactor(1.0),
+      zeroOffset(0.0),
+      owned(kQuantizedStride / 2, 0x8080),  // One sentinel row of -128 codes.
+      codes(owned.data())
+{
+}
+
+QuantizedQTable::QuantizedQTable(int nsStates, int ewStates, PolicyDType dtype, double scale, double offset,
+                                 std::shared_ptr<const MappedFile> mapping, const void* codes)
+    : nsCount(nsStates),
+      ewCount(ewStates),
+      type(dtype),
+      scaleFactor(scale),
+      zeroOffset(offset),
+      mapping(std::move(mapping)),
+      codes(codes)
+{
+}
+
+QuantizedQTable::QuantizedQTable(const QuantizedQTable& other)
+    : nsCount(other.nsCount),
+      ewCount(other.ewCount),
+      type(other.type),
+      scaleFactor(other.scaleFactor),
+      zeroOffset(other.zeroOffset),
+      owned(other.owned),
+      mapping(other.mapping),
+      codes(other.mapping ? other.codes : owned.data())
+{
+}
+
+QuantizedQTable& QuantizedQTable::operator=(QuantizedQTable other) noexcept {
+    // Swapping the vectors swaps their buffers, so codes stays valid on both sides.
+    std::swap(nsCount, other.nsCount);
+    std::swap(ewCount, other.ewCount);
+    std::swap(type, other.type);
+    std::swap(scaleFactor, other.scaleFactor);
+    std::swap(zeroOffset, other.zeroOffset);
+    owned.swap(other.owned);
+    mapping.swap(other.mapping);
+    std::swap(codes, other.codes);
+    return *this;
+}
+
+QuantizedQTable QuantizedQTable::quantize(const DenseQTable& table, PolicyDType dtype) {
+    QuantizedQTable quantized;
+    quantized.nsCount = table.nsStates();
+    quantized.ewCount = table.ewStates();
+    quantized.type = dtype == PolicyDType::Float16 ? PolicyDType::Float16 : PolicyDType::Int8;
+
+    // Centre the known values on zero and stretch them over the code range:
+    // [-127, 127] for int8, +-32768 for fp16 (well inside its 65504 limit).
+    double low = std::numeric_limits<double>::infinity();
+    double high = -low;
+    for (int ns = 0; ns < quantized.nsCount; ++ns) {
+        for (int ew = 0; ew < quantized.ewCount; ++ew) {
+            const double* v = table.values(ns, ew);
+            if (DenseQTable::isKnown(v)) {
+                low = std::min({ low, v[0], v[1], v[2] });
+                high = std::max({ high, v[0], v[1], v[2] });
+            }
+        }
+    }
+    double halfRange = high > low ? 0.5 * (high - low) : 0.0;
+    quantized.zeroOffset = high >= low ? 0.5 * (high + low) : 0.0;
+    double codeRange = quantized.type == PolicyDType::Int8 ? 127.0 : 32768.0;
+    quantized.scaleFactor = halfRange > 0.0 ? halfRange / codeRange : 1.0;
+
+    size_t rows = quantized.sentinelRow() + 1;
+    quantized.owned.assign((rows * kQuantizedStride * (quantized.type == PolicyDType::Int8 ? 1 : 2) + 1) / 2, 0);
+    quantized.codes = quantized.owned.data();
+    auto* int8Codes = reinterpret_cast<std::int8_t*>(quantized.owned.data());
+    std::uint16_t* halfCodes = quantized.owned.data();
+    for (size_t row = 0; row < rows; ++row) {
+        bool inside = row < quantized.sentinelRow();
+        const double* v = inside ? table.values(static_cast<int>(row / quantized.ewCount),
+                                                static_cast<int>(row % quantized.ewCount))
+                                 : nullptr;
+        bool known = inside && DenseQTable::isKnown(v);
+        for (int a = 0; a < kQuantizedStride; ++a) {
+            size_t i = row * kQuantizedStride + a;
+            double x = (known && a < kQActions) ? (v[a] - quantized.zeroOffset) / quantized.scaleFactor : 0.0;
+            if (quantized.type == PolicyDType::Int8) {
+                int8Codes[i] = known ? static_cast<std::int8_t>(std::clamp(std::lround(x), -127L, 127L)) : kInt8Unknown;
+            } else {
+                halfCodes[i] = known ? floatToHalf(static_cast<float>(x)) : kHalfUnknown;
+            }
+        }
+    }
+    return quantized;
+}
+
+void QuantizedQTable::values(int ns, int ew, double* out) const {
+    size_t row = rowIndex(ns, ew);
+    bool known = isKnown(ns, ew);
+    for (int a = 0; a < kQActions; ++a) {
+        double code = type == PolicyDType::Int8 ? int8Row(row)[a] : halfToFloat(halfRow(row)[a]);
+        out[a] = known ? code * scaleFactor + zeroOffset : std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+DenseQTable QuantizedQTable::dequantized() const {
+    DenseQTable table(nsCount, ewCount);
+    for (int ns = 0; ns < nsCount; ++ns) {
+        for (int ew = 0; ew < ewCount; ++ew) {
+            values(ns, ew, table.mutableValues(ns, ew));
+        }
+    }
+    return table;
+}
+
+QuantizationReport QuantizedQTable::compare(const DenseQTable& reference) const {
+    QuantizationReport report;
+    for (int ns = 0; ns < reference.nsStates(); ++ns) {
+        for (int ew = 0; ew < reference.ewStates(); ++ew) {
+            const double* v = reference.values(ns, ew);
+            if (!DenseQTable::isKnown(v)) {
+                continue;
+            }
+            double decoded[kQActions];
+            values(ns, ew, decoded);
+            for (int a = 0; a < kQActions; ++a) {
+                report.maxError = std::max(report.maxError, std::fabs(decoded[a] - v[a]));
+            }
+            ++report.states;
+            int expected = DenseQTable::argmax(v);
+            if (isKnown(ns, ew) && argmax(ns, ew) == expected) {
+                ++report.agreements;
+            }
+        }
+    }
+    // A second pass, now that the worst rounding error is known: disagreements
+    // between values closer than twice that error are ties the codes cannot split.
+    for (int ns = 0; ns < reference.nsStates(); ++ns) {
+        for (int ew = 0; ew < reference.ewStates(); ++ew) {
+            const double* v = reference.values(ns, ew);
+            if (!DenseQTable::isKnown(v) || argmax(ns, ew) == DenseQTable::argmax(v)) {
+                continue;
+            }
+            double gap = v[DenseQTable::argmax(v)] - v[argmax(ns, ew)];
+            if (gap <= 2.0 * report.maxError) {
+                ++report.nearTies;
+            }
+        }
+    }
+    return report;
+}
+
+const char* QuantizedQTable::dtypeName(PolicyDType dtype) {
+    switch (dtype) {
+    case PolicyDType::Float64: return "f64";
+    case PolicyDType::Int8: return "int8";
+    case PolicyDType::Float16: return "fp16";
+    }
+    return "unknown";
+}
+
+bool QuantizedQTable::parseDType(const std::string& name, PolicyDType& dtype) {
+    if (name == "f64") dtype = PolicyDType::Float64;
+    else if (name == "int8") dtype = PolicyDType::Int8;
+    else if (name == "fp16") dtype = PolicyDType::Float16;
+    else return false;
+    return true;
+}
+
+float QuantizedQTable::halfToFloat(std::uint16_t half) {
+    std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1F;
+    std::uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0) {
+        // Zero or subnormal: mantissa * 2^-24.
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    std::uint32_t bits = exponent == 0x1F ? (sign | 0x7F800000 | (mantissa << 13))
+                                          : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::uint16_t QuantizedQTable::floatToHalf(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+    std::uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude > 0x7F800000) {
+        return sign | kHalfUnknown;
+    }
+    if (magnitude >= 0x477FF000) {
+        return sign | 0x7C00;  // Rounds past 65504: infinity.
+    }
+    if (magnitude < 0x38800000) {
+        // Below the smallest normal half: round to a multiple of 2^-24.
+        float scaled = std::fabs(value) * 16777216.f;
+        return sign | static_cast<std::uint16_t>(std::nearbyint(scaled));
+    }
+    // Round to nearest even on the 13 dropped mantissa bits, then rebias the exponent.
+    std::uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+    return sign | static_cast<std::uint16_t>((rounded - 0x38000000) >> 13);
+}
@@ -0,0 +1,136 @@
+#ifndef QUANTIZEDQTABLE_HPP
+#define QUANTIZEDQTABLE_HPP
+
+#include "DenseQTable.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Value types a binary policy file can hold.
+enum class PolicyDType : std::uint32_t { Float64 = 0, Int8 = 1, Float16 = 2 };
+
+// Stored values per state in a quantized table: the kQActions values and one
+// pad, so a state is one aligned 4-byte (int8) or 8-byte (fp16) word.
+constexpr int kQuantizedStride = 4;
+
+// How closely a quantized table reproduces the full-precision greedy policy.
+struct QuantizationReport {
+    size_t states = 0;       // Known states compared.
+    size_t agreements = 0;   // States whose greedy action is unchanged.
+    size_t nearTies = 0;     // Disagreements whose best two values were within the rounding error.
+    double maxError = 0.0;   // Largest |dequantized - original| value.
+
+    double agreement() const { return states > 0 ? static_cast<double>(agreements) / states : 1.0; }
+};
+
+// Dense Q-table stored as int8 or fp16 codes, laid out like DenseQTable
+// ([ns][ew][value], sentinel row last) but 6x (int8) or 3x (fp16) smaller, so
+// the tables of a large network stay in cache. Values decode as
+// code * scale + offset, with one scale and offset per table. Both encodings
+// preserve order, so the greedy action is an argmax over the codes themselves
+// and a decision never decodes. Unknown states hold a reserved code (-128 for
+// int8, NaN for fp16).
+//
+// Like DenseQTable, a table either owns its codes or reads them in place from
+// a mapped policy file (see QTableLoader::loadQuantizedPolicyFile).
+class QuantizedQTable {
+public:
+    QuantizedQTable();
+    // A read-only view of (nsStates * ewStates + 1) * kQuantizedStride codes,
+    // sentinel row included, inside a mapped file.
+    QuantizedQTable(int nsStates, int ewStates, PolicyDType dtype, double scale, double offset,
+                    std::shared_ptr<const MappedFile> mapping, const void* codes);
+
+    QuantizedQTable(const QuantizedQTable& other);
+    QuantizedQTable(QuantizedQTable&& other) noexcept = default;
+    QuantizedQTable& operator=(QuantizedQTable other) noexcept;
+
+    // Quantizes a full-precision table to dtype (Int8 or Float16), fitting the
+    // scale and offset to the range of its known values.
+    static QuantizedQTable quantize(const DenseQTable& table, PolicyDType dtype);
+    // The decoded table, e.g. for writing q_table.json or to keep learning.
+    DenseQTable dequantized() const;
+    // Greedy-action agreement with the table this one was quantized from.
+    QuantizationReport compare(const DenseQTable& reference) const;
+
+    int nsStates() const { return nsCount; }
+    int ewStates() const { return ewCount; }
+    PolicyDType dtype() const { return type; }
+    double scale() const { return scaleFactor; }
+    double offset() const { return zeroOffset; }
+    // All codes, sentinel row included, e.g. for writing a policy file.
+    const void* data() const { return codes; }
+    size_t codeCount() const { return (sentinelRow() + 1) * kQuantizedStride; }
+    size_t byteCount() const { return codeCount() * (type == PolicyDType::Int8 ? 1 : 2); }
+
+    bool isKnown(int ns, int ew) const {
+        size_t row = rowIndex(ns, ew);
+        if (type == PolicyDType::Int8) {
+            return int8Row(row)[0] != kInt8Unknown;
+        }
+        return (halfRow(row)[0] & 0x7FFF) <= 0x7C00;
+    }
+    // Index of the largest value, compared as codes; ties go to the lower action.
+    int argmax(int ns, int ew) const {
+        size_t row = rowIndex(ns, ew);
+        if (type == PolicyDType::Int8) {
+            const std::int8_t* v = int8Row(row);
+            return argmax3(v[0], v[1], v[2]);
+        }
+        const std::uint16_t* h = halfRow(row);
+        return argmax3(halfKey(h[0]), halfKey(h[1]), halfKey(h[2]));
+    }
+    // Decodes a state's kQActions values (NaN when unknown).
+    void values(int ns, int ew, double* out) const;
+
+    static const char* dtypeName(PolicyDType dtype);
+    // Accepts "int8", "fp16" and "f64".
+    static bool parseDType(const std::string& name, PolicyDType& dtype);
+
+    static float halfToFloat(std::uint16_t half);
+    static std::uint16_t floatToHalf(float value);
+
+private:
+    static constexpr std::int8_t kInt8Unknown = -128;
+
+    size_t sentinelRow() const { return static_cast<size_t>(nsCount) * ewCount; }
+    // Out-of-range states map to the sentinel row without branching.
+    size_t rowIndex(int ns, int ew) const {
+        unsigned uns = static_cast<unsigned>(ns);
+        unsigned uew = static_cast<unsigned>(ew);
+        bool inside = (uns < static_cast<unsigned>(nsCount)) & (uew < static_cast<unsigned>(ewCount));
+        return inside ? static_cast<size_t>(uns) * ewCount + uew : sentinelRow();
+    }
+    const std::int8_t* int8Row(size_t row) const {
+        return static_cast<const std::int8_t*>(codes) + row * kQuantizedStride;
+    }
+    const std::uint16_t* halfRow(size_t row) const {
+        return static_cast<const std::uint16_t*>(codes) + row * kQuantizedStride;
+    }
+    // Maps fp16 bits to an integer with the same order, without branching:
+    // negative values flip their magnitude bits (-0 orders just below +0).
+    static int halfKey(std::uint16_t half) {
+        int bits = static_cast<std::int16_t>(half);
+        return bits ^ ((bits >> 15) & 0x7FFF);
+    }
+    // Ties go to the lower action; selects rather than branches on random data.
+    template <typename T>
+    static int argmax3(T a, T b, T c) {
+        int best = b > a;
+        T top = best ? b : a;
+        int third = c > top;
+        return best + third * (2 - best);
+    }
+
+    int nsCount;
+    int ewCount;
+    PolicyDType type;
+    double scaleFactor;
+    double zeroOffset;
+    std::vector<std::uint16_t> owned;            // Codes owned by the table (uint16 for alignment)...
+    std::shared_ptr<const MappedFile> mapping;   // ...or the mapped file they live in.
+    const void* codes = nullptr;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "ReplayBuffer.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static const std::uint32_t kReplayVersion = 1;
+static const double kPriorityEpsilon = 1e-3;   // Keeps zero-error records sampleable.
+static const int kReadAttempts = 8;            // Resamples of a record overwritten mid-copy.
+
+static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t) &&
+              std::atomic<std::uint64_t>::is_always_lock_free,
+              "Replay counters live in the mapped file and must be plain lock-free words");
+
+ReplayBuffer::ReplayBuffer(const std::string& filename, size_t capacity, double priorityAlpha)
+    : slots(std::max<size_t>(capacity, 1)),
+      alpha(priorityAlpha)
+{
+    size_t sequenceBytes = slots * sizeof(std::uint64_t);
+    size_t priorityBytes = (slots * sizeof(float) + 7) & ~size_t(7);
+    size_t total = sizeof(ReplayFileHeader) + sequenceBytes + priorityBytes + slots * sizeof(ReplayRecord);
+    file = std::make_unique<MappedFile>(filename, total);
+    if (!file->isOpen()) {
+        std::cerr << "Unable to map replay file: " << filename << std::endl;
+        return;
+    }
+    char* base = file->mutableData();
+    header = reinterpret_cast<ReplayFileHeader*>(base);
+    appendedCount = reinterpret_cast<std::atomic<std::uint64_t>*>(&header->appended);
+    sequences = reinterpret_cast<std::atomic<std::uint64_t>*>(base + sizeof(ReplayFileHeader));
+    priorities = reinterpret_cast<float*>(base + sizeof(ReplayFileHeader) + sequenceBytes);
+    records = reinterpret_cast<ReplayRecord*>(base + sizeof(ReplayFileHeader) + sequenceBytes + priorityBytes);
+
+    bool resumable = std::memcmp(header->magic, "TRB1", 4) == 0 && header->version == kReplayVersion &&
+                     header->recordSize == sizeof(ReplayRecord) && header->observationSize == kObservationSize &&
+                     header->capacity == slots;
+    if (!resumable) {
+        std::memset(base, 0, total);
+        std::memcpy(header->magic, "TRB1", 4);
+        header->version = kReplayVersion;
+        header->recordSize = sizeof(ReplayRecord);
+        header->observationSize = kObservationSize;
+        header->capacity = slots;
+    }
+
+    while (leaves < slots) leaves *= 2;
+    tree.assign(2 * leaves, 0.0);
+    for (size_t slot = 0; slot < slots; ++slot) {
+        if (sequences[slot].load(std::memory_order_relaxed) != 0) {
+            maxPriority = std::max(maxPriority, static_cast<double>(priorities[slot]));
+        }
+    }
+    // Records appended by a producer alone (or after a trainer's last catch-up)
+    // were never given a priority; they enter at the highest one, like new records.
+    for (size_t slot = 0; slot < slots; ++slot) {
+        if (sequences[slot].load(std::memory_order_relaxed) != 0) {
+            if (priorities[slot] <= 0.f) {
+                priorities[slot] = static_cast<float>(maxPriority);
+            }
+            tree[leaves + slot] = priorities[slot];
+        }
+    }
+    for (size_t k = leaves - 1; k >= 1; --k) {
+        tree[k] = tree[2 * k] + tree[2 * k + 1];
+    }
+    treeSynced = appended();
+}
+
+ReplayBuffer::~ReplayBuffer() = default;
+
+std::uint64_t ReplayBuffer::appended() const {
+    return appendedCount ? appendedCount->load(std::memory_order_acquire) : 0;
+}
+
+size_t ReplayBuffer::size() const {
+    return static_cast<size_t>(std::min<std::uint64_t>(appended(), slots));
+}
+
+std::uint64_t ReplayBuffer::append(const ReplayRecord& record) {
+    if (!header) {
+        return 0;
+    }
+    std::uint64_t index = appendedCount->load(std::memory_order_relaxed);
+    size_t slot = static_cast<size_t>(index % slots);
+    // Seqlock write: invalidate, write, then publish the new sequence.
+    sequences[slot].store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&records[slot], &record, sizeof(ReplayRecord));
+    sequences[slot].store(index + 1, std::memory_order_release);
+    appendedCount->store(index + 1, std::memory_order_release);
+    return index;
+}
+
+void ReplayBuffer::markDone(std::uint64_t index) {
+    if (!header) {
+        return;
+    }
+    size_t slot = static_cast<size_t>(index % slots);
+    if (sequences[slot].load(std::memory_order_relaxed) != index + 1) {
+        return;
+    }
+    // The same seqlock write as append, so readers never see it half-done.
+    sequences[slot].store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    records[slot].done = 1;
+    sequences[slot].store(index + 1, std::memory_order_release);
+}
+
+bool ReplayBuffer::read(std::uint64_t index, ReplayRecord& out) const {
+    size_t slot = static_cast<size_t>(index % slots);
+    if (sequences[slot].load(std::memory_order_acquire) != index + 1) {
+        return false;
+    }
+    std::memcpy(&out, &records[slot], sizeof(ReplayRecord));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequences[slot].load(std::memory_order_relaxed) == index + 1;
+}
+
+int ReplayBuffer::sampleUniform(SimRng& rng, int count, ReplayRecord* out, std::uint64_t* indices) const {
+    int written = 0;
+    for (int attempt = 0; written < count && attempt < count * kReadAttempts; ++attempt) {
+        std::uint64_t end = appended();
+        std::uint64_t available = std::min<std::uint64_t>(end, slots);
+        if (available == 0) {
+            break;
+        }
+        // Uniform over the live window [end - available, end).
+        std::uint64_t index = end - available + rng.next() % available;
+        if (read(index, out[written])) {
+            if (indices) indices[written] = index;
+            ++written;
+        }
+    }
+    return written;
+}
+
+void ReplayBuffer::setPriority(size_t slot, double priority) {
+    priorities[slot] = static_cast<float>(priority);
+    size_t k = leaves + slot;
+    double delta = priority - tree[k];
+    for (; k >= 1; k /= 2) {
+        tree[k] += delta;
+    }
+}
+
+void ReplayBuffer::catchUp() {
+    std::uint64_t end = appended();
+    std::uint64_t from = std::max(treeSynced, end > slots ? end - slots : 0);
+    for (std::uint64_t index = from; index < end; ++index) {
+        setPriority(static_cast<size_t>(index % slots), maxPriority);
+    }
+    treeSynced = end;
+}
+
+int ReplayBuffer::samplePrioritized(SimRng& rng, int count, ReplayRecord* out, std::uint64_t* indices,
+                                    double* probabilities) {
+    if (!header || count <= 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(priorityMutex);
+    catchUp();
+    double total = tree[1];
+    int written = 0;
+    for (int attempt = 0; written < count && attempt < count * kReadAttempts && total > 0.0; ++attempt) {
+        // Stratified: one draw from each of count equal slices of the total.
+        double u = (written + rng.nextFloat()) * total / count;
+        size_t k = 1;
+        while (k < leaves) {
+            k *= 2;
+            if (u >= tree[k] && tree[k + 1] > 0.0) {
+                u -= tree[k];
+                ++k;
+            }
+        }
+        size_t slot = k - leaves;
+        if (slot >= slots) {
+            continue;
+        }
+        std::uint64_t sequence = sequences[slot].load(std::memory_order_acquire);
+        if (sequence == 0 || !read(sequence - 1, out[written])) {
+            continue;
+        }
+        indices[written] = sequence - 1;
+        if (probabilities) probabilities[written] = tree[k] / total;
+        ++written;
+    }
+    return written;
+}
+
+void ReplayBuffer::updatePriority(std::uint64_t index, double tdError) {
+    std::lock_guard<std::mutex> lock(priorityMutex);
+    size_t slot = static_cast<size_t>(index % slots);
+    // A record overwritten since it was sampled keeps its fresh priority.
+    if (sequences[slot].load(std::memory_order_acquire) != index + 1) {
+        return;
+    }
+    double priority = std::pow(std::fabs(tdError) + kPriorityEpsilon, alpha);
+    maxPriority = std::max(maxPriority, priority);
+    setPriority(slot, priority);
+}
+
+void ReplayBuffer::flush() const {
+    if (file) file->flush();
+}
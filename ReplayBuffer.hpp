@@ -0,0 +1,109 @@
+#ifndef REPLAYBUFFER_HPP
+#define REPLAYBUFFER_HPP
+
+#include "QFunction.hpp"
+#include "SimRng.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+// One logged decision.
+struct ReplayRecord {
+    float observation[kObservationSize];
+    float next[kObservationSize];
+    std::int32_t action;
+    float reward;
+    std::uint32_t done;       // 1 when next ends the episode.
+    std::uint32_t reserved;
+};
+static_assert(sizeof(ReplayRecord) == 8 * kObservationSize + 16, "Replay records must stay packed");
+
+// Header at the start of a replay file.
+struct ReplayFileHeader {
+    char magic[4];                 // "TRB1"
+    std::uint32_t version;
+    std::uint32_t recordSize;      // sizeof(ReplayRecord) when written.
+    std::uint32_t observationSize;
+    std::uint64_t capacity;
+    std::uint64_t appended;        // Records ever appended; an atomic counter in the mapping.
+    std::uint8_t reserved[32];     // Pads the header to 64 bytes.
+};
+static_assert(sizeof(ReplayFileHeader) == 64, "Replay file header must stay 64 bytes");
+
+// Fixed-size experience replay kept in a memory-mapped ring file, so logged
+// decisions survive restarts and a long run never holds more than the ring in
+// RAM. The file holds the header, one sequence number per slot, one priority
+// per slot and then the records.
+//
+// One producer (e.g. the simulation thread) appends without locks, overwriting
+// the oldest record once the ring is full. Any number of trainer threads
+// sample concurrently: each slot's sequence number brackets its record like a
+// seqlock, so a record overwritten while being copied is detected and
+// resampled. Prioritized sampling (proportional, with a sum tree) is shared
+// between trainers under a mutex the producer never takes; new records enter
+// it at the highest priority seen so far.
+class ReplayBuffer {
+public:
+    // Opens or creates filename. An existing ring of the same capacity is
+    // resumed; anything else is replaced by an empty ring.
+    ReplayBuffer(const std::string& filename, size_t capacity, double priorityAlpha = 0.6);
+    ~ReplayBuffer();
+
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    bool isOpen() const { return header != nullptr; }
+    size_t capacity() const { return slots; }
+    // Records ever appended, across restarts; record i lives while i >= appended() - capacity().
+    std::uint64_t appended() const;
+    size_t size() const;
+
+    // Producer side; one thread only. append returns the record's index.
+    std::uint64_t append(const ReplayRecord& record);
+    // Sets done on record index, e.g. once its episode is known to have ended
+    // there; a record already overwritten is left alone.
+    void markDone(std::uint64_t index);
+
+    // Trainer side. Both return how many of count samples were written to out;
+    // fewer only while the ring is (nearly) empty. indices receives each
+    // sample's record index for updatePriority.
+    int sampleUniform(SimRng& rng, int count, ReplayRecord* out, std::uint64_t* indices = nullptr) const;
+    // probabilities receives each sample's selection probability, for
+    // importance-sampling weights.
+    int samplePrioritized(SimRng& rng, int count, ReplayRecord* out, std::uint64_t* indices,
+                          double* probabilities = nullptr);
+    // Sets a sampled record's priority from its latest TD error.
+    void updatePriority(std::uint64_t index, double tdError);
+
+    void flush() const;
+
+private:
+    // Copies record index into out if it is still in the ring, unchanged.
+    bool read(std::uint64_t index, ReplayRecord& out) const;
+    // Brings the sum tree up to date with appends since the last call.
+    void catchUp();
+    void setPriority(size_t slot, double priority);
+
+    std::unique_ptr<MappedFile> file;
+    ReplayFileHeader* header = nullptr;
+    std::atomic<std::uint64_t>* appendedCount = nullptr;  // header->appended.
+    std::atomic<std::uint64_t>* sequences = nullptr;      // Index + 1 of each slot's record; 0 while empty or being written.
+    float* priorities = nullptr;                          // Persisted leaf priorities.
+    ReplayRecord* records = nullptr;
+    size_t slots = 0;
+
+    // Prioritized sampling, trainers only.
+    double alpha;
+    std::mutex priorityMutex;
+    std::vector<double> tree;   // Sum tree: node k sums children 2k and 2k+1; leaves from `leaves`.
+    size_t leaves = 1;
+    std::uint64_t treeSynced = 0;
+    double maxPriority = 1.0;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SIMRNG_HPP
+#define SIMRNG_HPP
+
+#include <cstdint>
+
+// Small, fast random generator (splitmix64) whose whole state is one word.
+// Every simulation owns one, so runs can be seeded independently, run on
+// separate threads and have their random stream saved with them.
+struct SimRng {
+    std::uint64_t state;
+
+    explicit SimRng(std::uint64_t seed = 0) : state(seed) {}
+
+    std::uint64_t next() {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform integer in [0, n).
+    int nextInt(int n) {
+        return static_cast<int>((next() >> 33) % static_cast<std::uint64_t>(n));
+    }
+
+    // Uniform float in [0, 1).
+    float nextFloat() {
+        return static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+    }
+};
+
+#endif
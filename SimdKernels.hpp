@@ -0,0 +1,289 @@
+#ifndef SIMDKERNELS_HPP
+#define SIMDKERNELS_HPP
+
+// Float vector kernels for the function-approximation policies. With AVX2 and
+// FMA enabled at compile time (-mavx2 -mfma, or -march=native) they process
+// eight lanes per instruction; otherwise a scalar fallback with independent
+// accumulators, which compilers can still auto-vectorize, is used.
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define SIMD_KERNELS_AVX2 1
+#endif
+
+namespace simd {
+
+#ifdef SIMD_KERNELS_AVX2
+
+inline float horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+// Sum of a[i] * b[i].
+inline float dot(const float* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = horizontalSum(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// R rows of y = M x at once, so each load of x serves all of them.
+template <int R>
+inline void matvecRows(const float* m, int cols, const float* x, float* y) {
+    __m256 acc[R];
+    const float* row[R];
+    for (int k = 0; k < R; ++k) {
+        acc[k] = _mm256_setzero_ps();
+        row[k] = m + static_cast<long>(k) * cols;
+    }
+    int i = 0;
+    for (; i + 8 <= cols; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+#pragma GCC unroll 4
+        for (int k = 0; k < R; ++k) {
+            acc[k] = _mm256_fmadd_ps(_mm256_loadu_ps(row[k] + i), v, acc[k]);
+        }
+    }
+    for (int k = 0; k < R; ++k) {
+        float sum = horizontalSum(acc[k]);
+        const float* row = m + static_cast<long>(k) * cols;
+        for (int j = i; j < cols; ++j) {
+            sum += row[j] * x[j];
+        }
+        y[k] = sum;
+    }
+}
+
+// y = M x for a row-major rows x cols matrix, four rows at a time.
+inline void matvec(const float* m, int rows, int cols, const float* x, float* y) {
+    int r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        matvecRows<4>(m + static_cast<long>(r) * cols, cols, x, y + r);
+    }
+    const float* rest = m + static_cast<long>(r) * cols;
+    switch (rows - r) {
+    case 3: matvecRows<3>(rest, cols, x, y + r); break;
+    case 2: matvecRows<2>(rest, cols, x, y + r); break;
+    case 1: matvecRows<1>(rest, cols, x, y + r); break;
+    default: break;
+    }
+}
+
+// y = x M for a row-major rows x cols matrix: each x[r] is broadcast over row
+// r, so outputs accumulate lane-wise with no horizontal sums. Columns are
+// processed 32 at a time, four accumulators held in registers.
+inline void vecmat(const float* x, const float* m, int rows, int cols, float* y) {
+    int c = 0;
+    for (; c + 32 <= cols; c += 32) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+        const float* col = m + c;
+        for (int r = 0; r < rows; ++r, col += cols) {
+            __m256 v = _mm256_set1_ps(x[r]);
+            acc0 = _mm256_fmadd_ps(v, _mm256_loadu_ps(col), acc0);
+            acc1 = _mm256_fmadd_ps(v, _mm256_loadu_ps(col + 8), acc1);
+            acc2 = _mm256_fmadd_ps(v, _mm256_loadu_ps(col + 16), acc2);
+            acc3 = _mm256_fmadd_ps(v, _mm256_loadu_ps(col + 24), acc3);
+        }
+        _mm256_storeu_ps(y + c, acc0);
+        _mm256_storeu_ps(y + c + 8, acc1);
+        _mm256_storeu_ps(y + c + 16, acc2);
+        _mm256_storeu_ps(y + c + 24, acc3);
+    }
+    for (; c + 8 <= cols; c += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        const float* col = m + c;
+        for (int r = 0; r < rows; ++r, col += cols) {
+            acc = _mm256_fmadd_ps(_mm256_set1_ps(x[r]), _mm256_loadu_ps(col), acc);
+        }
+        _mm256_storeu_ps(y + c, acc);
+    }
+    for (; c < cols; ++c) {
+        float sum = 0.f;
+        for (int r = 0; r < rows; ++r) {
+            sum += x[r] * m[static_cast<long>(r) * cols + c];
+        }
+        y[c] = sum;
+    }
+}
+
+// Y = X M for count rows of X (row stride rows) and a row-major rows x cols M.
+// Four rows of X share each load of M, so a batch reads the weights a quarter
+// as often as count separate vecmat calls.
+inline void matmat(const float* x, int count, const float* m, int rows, int cols, float* y) {
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float* x0 = x + static_cast<long>(i) * rows;
+        const float* x1 = x0 + rows;
+        const float* x2 = x1 + rows;
+        const float* x3 = x2 + rows;
+        float* y0 = y + static_cast<long>(i) * cols;
+        int c = 0;
+        for (; c + 16 <= cols; c += 16) {
+            __m256 a00 = _mm256_setzero_ps(), a01 = _mm256_setzero_ps();
+            __m256 a10 = _mm256_setzero_ps(), a11 = _mm256_setzero_ps();
+            __m256 a20 = _mm256_setzero_ps(), a21 = _mm256_setzero_ps();
+            __m256 a30 = _mm256_setzero_ps(), a31 = _mm256_setzero_ps();
+            const float* col = m + c;
+            for (int r = 0; r < rows; ++r, col += cols) {
+                __m256 w0 = _mm256_loadu_ps(col);
+                __m256 w1 = _mm256_loadu_ps(col + 8);
+                __m256 v = _mm256_set1_ps(x0[r]);
+                a00 = _mm256_fmadd_ps(v, w0, a00);
+                a01 = _mm256_fmadd_ps(v, w1, a01);
+                v = _mm256_set1_ps(x1[r]);
+                a10 = _mm256_fmadd_ps(v, w0, a10);
+                a11 = _mm256_fmadd_ps(v, w1, a11);
+                v = _mm256_set1_ps(x2[r]);
+                a20 = _mm256_fmadd_ps(v, w0, a20);
+                a21 = _mm256_fmadd_ps(v, w1, a21);
+                v = _mm256_set1_ps(x3[r]);
+                a30 = _mm256_fmadd_ps(v, w0, a30);
+                a31 = _mm256_fmadd_ps(v, w1, a31);
+            }
+            _mm256_storeu_ps(y0 + c, a00);
+            _mm256_storeu_ps(y0 + c + 8, a01);
+            _mm256_storeu_ps(y0 + cols + c, a10);
+            _mm256_storeu_ps(y0 + cols + c + 8, a11);
+            _mm256_storeu_ps(y0 + 2 * cols + c, a20);
+            _mm256_storeu_ps(y0 + 2 * cols + c + 8, a21);
+            _mm256_storeu_ps(y0 + 3 * cols + c, a30);
+            _mm256_storeu_ps(y0 + 3 * cols + c + 8, a31);
+        }
+        if (c < cols) {
+            // Narrow remainder (e.g. the kQActions output layer): row by row.
+            for (int k = 0; k < 4; ++k) {
+                const float* xk = x0 + static_cast<long>(k) * rows;
+                for (int j = c; j < cols; ++j) {
+                    float sum = 0.f;
+                    for (int r = 0; r < rows; ++r) {
+                        sum += xk[r] * m[static_cast<long>(r) * cols + j];
+                    }
+                    y0[static_cast<long>(k) * cols + j] = sum;
+                }
+            }
+        }
+    }
+    for (; i < count; ++i) {
+        vecmat(x + static_cast<long>(i) * rows, m, rows, cols, y + static_cast<long>(i) * cols);
+    }
+}
+
+// y[i] += alpha * x[i].
+inline void axpy(float alpha, const float* x, float* y, int n) {
+    __m256 a = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+// y[i] = s * x[i].
+inline void scale(float s, const float* x, float* y, int n) {
+    __m256 f = _mm256_set1_ps(s);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(f, _mm256_loadu_ps(x + i)));
+    }
+    for (; i < n; ++i) {
+        y[i] = s * x[i];
+    }
+}
+
+#else
+
+inline float dot(const float* a, const float* b, int n) {
+    float acc[4] = { 0.f, 0.f, 0.f, 0.f };
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += a[i] * b[i];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+    }
+    float sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+inline void matvec(const float* m, int rows, int cols, const float* x, float* y) {
+    for (int r = 0; r < rows; ++r) {
+        y[r] = dot(m + static_cast<long>(r) * cols, x, cols);
+    }
+}
+
+inline void vecmat(const float* x, const float* m, int rows, int cols, float* y) {
+    // Eight columns at a time in independent accumulators.
+    int c = 0;
+    for (; c + 8 <= cols; c += 8) {
+        float acc[8] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+        const float* col = m + c;
+        for (int r = 0; r < rows; ++r, col += cols) {
+            for (int j = 0; j < 8; ++j) {
+                acc[j] += x[r] * col[j];
+            }
+        }
+        for (int j = 0; j < 8; ++j) {
+            y[c + j] = acc[j];
+        }
+    }
+    for (; c < cols; ++c) {
+        float sum = 0.f;
+        for (int r = 0; r < rows; ++r) {
+            sum += x[r] * m[static_cast<long>(r) * cols + c];
+        }
+        y[c] = sum;
+    }
+}
+
+inline void matmat(const float* x, int count, const float* m, int rows, int cols, float* y) {
+    for (int i = 0; i < count; ++i) {
+        vecmat(x + static_cast<long>(i) * rows, m, rows, cols, y + static_cast<long>(i) * cols);
+    }
+}
+
+inline void axpy(float alpha, const float* x, float* y, int n) {
+    for (int i = 0; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+inline void scale(float s, const float* x, float* y, int n) {
+    for (int i = 0; i < n; ++i) {
+        y[i] = s * x[i];
+    }
+}
+
+#endif
+
+// Name of the kernel set compiled in, for benchmark reports.
+inline const char* kernelName() {
+#ifdef SIMD_KERNELS_AVX2
+    return "AVX2/FMA";
+#else
+    return "scalar";
+#endif
+}
+
+}  // namespace simd
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for one producer thread and one consumer thread.
+// Capacity must be a power of two. Neither side ever blocks: push fails when
+// the queue is full and pop when it is empty. The two indices sit on separate
+// cache lines so the threads do not contend for one.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    bool push(const T& item) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[tail & (Capacity - 1)] = item;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[head & (Capacity - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> headIndex{0};  // Next slot to pop (consumer).
+    alignas(64) std::atomic<size_t> tailIndex{0};  // Next slot to fill (producer).
+    alignas(64) T slots[Capacity];
+};
+
+#endif
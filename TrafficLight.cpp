@@ -1,48 +1,54 @@
 #include "TrafficLight.hpp"
 #include <iostream>
 
-TrafficLight::TrafficLight(const sf::Vector2f& position)
+TrafficLight::TrafficLight(const sf::Vector2f& position, bool loadTextures)
     : state(LightState::Red),
       timer(0.f),
       redDuration(5.f),
       yellowDuration(2.f),
       greenDuration(5.f)
 {
+    if (!loadTextures) {
+        return;
+    }
+
     // 1) Load traffic light textures
-    if (!redTexture.loadFromFile("C:/TrafficLightSimulation/assets/red.png")) {
+    auto loaded = std::make_shared<Textures>();
+    if (!loaded->red.loadFromFile("C:/TrafficLightSimulation/assets/red.png")) {
         std::cerr << "Failed to load red.png\n";
     }
-    if (!yellowTexture.loadFromFile("C:/TrafficLightSimulation/assets/yellow.png")) {
+    if (!loaded->yellow.loadFromFile("C:/TrafficLightSimulation/assets/yellow.png")) {
         std::cerr << "Failed to load yellow.png\n";
     }
-    if (!greenTexture.loadFromFile("C:/TrafficLightSimulation/assets/green.png")) {
+    if (!loaded->green.loadFromFile("C:/TrafficLightSimulation/assets/green.png")) {
         std::cerr << "Failed to load green.png\n";
     }
 
     // 2) Load the post texture
-    if (!postTexture.loadFromFile("C:/TrafficLightSimulation/assets/post.png")) {
+    if (!loaded->post.loadFromFile("C:/TrafficLightSimulation/assets/post.png")) {
         std::cerr << "Failed to load post.png\n";
     }
+    textures = loaded;
 
     // ------------------------------------------------------
     // 3) Configure the traffic light sprite (initially red)
     // ------------------------------------------------------
-    sprite.setTexture(redTexture);
+    sprite.setTexture(textures->red);
     // Unified scale: let's use 0.04 for the light
     sprite.setScale(0.04f, 0.04f);
 
-    sf::Vector2u lightSize = redTexture.getSize();
+    sf::Vector2u lightSize = textures->red.getSize();
     // Anchor the light so its bottom-center is at (0, 0)
     sprite.setOrigin(lightSize.x * 0.5f, lightSize.y);
 
     // ------------------------------------------------------
     // 4) Configure the post sprite
     // ------------------------------------------------------
-    postSprite.setTexture(postTexture);
+    postSprite.setTexture(textures->post);
     // A bit smaller scale for the post
     postSprite.setScale(0.02f, 0.02f);
 
-    sf::Vector2u postSize = postTexture.getSize();
+    sf::Vector2u postSize = textures->post.getSize();
     // Anchor the post so its top-center is at (0, 0)
     postSprite.setOrigin(postSize.x * 0.5f, 0.f);
 
@@ -60,34 +66,27 @@ TrafficLight::TrafficLight(const sf::Vector2f& position)
     state = LightState::Red;
 }
 
-void TrafficLight::switchToRed() {
-    sprite.setTexture(redTexture);
+void TrafficLight::showLamp(const sf::Texture& texture) {
+    sprite.setTexture(texture);
     sprite.setScale(0.04f, 0.04f);
 
-    sf::Vector2u texSize = redTexture.getSize();
+    sf::Vector2u texSize = texture.getSize();
     // bottom-center origin
     sprite.setOrigin(texSize.x * 0.5f, texSize.y);
+}
 
+void TrafficLight::switchToRed() {
+    if (textures) showLamp(textures->red);
     state = LightState::Red;
 }
 
 void TrafficLight::switchToYellow() {
-    sprite.setTexture(yellowTexture);
-    sprite.setScale(0.04f, 0.04f);
-
-    sf::Vector2u texSize = yellowTexture.getSize();
-    sprite.setOrigin(texSize.x * 0.5f, texSize.y);
-
+    if (textures) showLamp(textures->yellow);
     state = LightState::Yellow;
 }
 
 void TrafficLight::switchToGreen() {
-    sprite.setTexture(greenTexture);
-    sprite.setScale(0.04f, 0.04f);
-
-    sf::Vector2u texSize = greenTexture.getSize();
-    sprite.setOrigin(texSize.x * 0.5f, texSize.y);
-
+    if (textures) showLamp(textures->green);
     state = LightState::Green;
 }
 
@@ -2,6 +2,7 @@
 #define TRAFFICLIGHT_HPP
 
 #include <SFML/Graphics.hpp>
+#include <memory>
 
 // Simple states for a single traffic light
 // Red/Yellow/Green for this example
@@ -9,7 +10,8 @@ enum class LightState { Red, Yellow, Green };
 
 class TrafficLight {
 public:
-    TrafficLight(const sf::Vector2f& position);
+    // Headless simulations pass loadTextures = false so no image is ever loaded.
+    TrafficLight(const sf::Vector2f& position, bool loadTextures = true);
 
     void update(float dt);
     void render(sf::RenderWindow& window);
@@ -28,15 +30,21 @@ private:
     float yellowDuration;
     float greenDuration;
 
-    sf::Texture redTexture;
-    sf::Texture yellowTexture;
-    sf::Texture greenTexture;
+    // Textures are shared between copies of a light (e.g. in simulation forks),
+    // so copying a light never copies images. Null in headless runs.
+    struct Textures {
+        sf::Texture red;
+        sf::Texture yellow;
+        sf::Texture green;
+        sf::Texture post;
+    };
+    std::shared_ptr<const Textures> textures;
     sf::Sprite sprite;
 
-    // New: a post texture and sprite
-    sf::Texture postTexture;
+    // New: a post sprite
     sf::Sprite postSprite;
 
+    void showLamp(const sf::Texture& texture);
     void switchToRed();
     void switchToYellow();
     void switchToGreen();
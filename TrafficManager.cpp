@@ -1,6 +1,9 @@
 #include "TrafficManager.hpp"
 #include "json.hpp"          // nlohmann::json header
 #include "QTableLoader.hpp"  
+#include "Movements.hpp"
+#include "VehicleClass.hpp"
+#include "Checksum.hpp"
 #include <algorithm>
 #include <cstdlib>
 #include <ctime>
@@ -9,6 +12,11 @@
 #include <climits>
 #include <cmath>
 #include <unordered_map>
+#include <iterator>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <atomic>
 
 // Utility: Convert a state (pair) to a string that matches the JSON Q‑table keys.
 std::string stateToString(const std::pair<int, int>& state) {
@@ -17,27 +25,140 @@ std::string stateToString(const std::pair<int, int>& state) {
     return oss.str();
 }
 
-TrafficManager::TrafficManager()
-    : topLeftLight(sf::Vector2f(310.f, 160.f)),
-      topRightLight(sf::Vector2f(600.f, 160.f)),
-      bottomLeftLight(sf::Vector2f(310.f, 440.f)),
-      bottomRightLight(sf::Vector2f(600.f, 440.f)),
+// Movements permitted in each phase, indexed by Phase. Yellow admits nothing new.
+constexpr std::uint64_t kPhaseMasks[] = {
+    approachMask(Direction::TopToBottom) | approachMask(Direction::BottomToTop),  // NS_Green
+    0,                                                                            // NS_Yellow
+    approachMask(Direction::LeftToRight) | approachMask(Direction::RightToLeft),  // EW_Green
+    0                                                                             // EW_Yellow
+};
+static_assert(isConflictFree(kPhaseMasks[0]) && isConflictFree(kPhaseMasks[2]),
+              "A phase may only permit non-conflicting movements");
+
+// Road centre of each direction of travel, indexed by Direction
+// (x for vertical directions, y for horizontal ones). A single lane sits here.
+constexpr float kLaneCoord[] = { 390.f, 500.f, 250.f, 350.f };
+
+// Extra lanes fan out from kLaneCoord by kLaneSpacing; lane 0 is the outermost
+// lane and kLaneOutward gives the side of the road centre line it lies on.
+constexpr float kLaneSpacing = 30.f;
+constexpr float kLaneOutward[] = { -1.f, 1.f, -1.f, 1.f };
+
+// Gap a vehicle needs both ahead and behind in the target lane to change into it.
+constexpr float kLaneChangeGap = 80.f;
+
+// Stop line per approach, expressed as progress along the direction of travel
+// (progress = sign * coordinate, so it always increases as a vehicle advances).
+constexpr float kTravelSign[] = { 1.f, -1.f, 1.f, -1.f };
+constexpr float kStopLineProgress[] = { 150.f, -450.f, 300.f, -605.f };
+
+// A permissive movement waits at its stop line while a movement it yields to
+// has a vehicle in the near half of the junction, or closer to its stop line
+// than kYieldDistance plus kYieldGapSeconds of travel. The first vehicle left
+// waiting there clears the junction as the green ends.
+constexpr float kYieldDistance = 40.f;
+constexpr float kYieldGapSeconds = 2.f;
+constexpr float kYieldStopTolerance = 1.f;
+
+// Progress of a vehicle along a direction of travel.
+static float progressAlong(const Vehicle& v, int d) {
+    return kTravelSign[d] * (isVertical(static_cast<Direction>(d)) ? v.getY() : v.getX());
+}
+
+static float progressOf(const Vehicle& v) {
+    return progressAlong(v, static_cast<int>(v.getDirection()));
+}
+
+// Lane a movement must use: left turns leave from the inner lane, right turns
+// from the outer one. Straight-through vehicles may use any lane (-1).
+static int requiredLane(Movement m, int laneCount) {
+    if (m == Movement::Left) return laneCount - 1;
+    if (m == Movement::Right) return 0;
+    return -1;
+}
+
+bool ControllerSettings::isValid(std::string* reason) const {
+    const char* problem = nullptr;
+    if (!(greenTime > 0.f) || !(yellowTime > 0.f) || !(minGreen > 0.f)) {
+        problem = "greenTime, yellowTime and minGreen must be positive";
+    } else if (!(minGreen <= maxGreen)) {
+        problem = "minGreen must not exceed maxGreen";
+    } else if (!(priorityHold >= 0.f)) {
+        problem = "priorityHold must not be negative";
+    } else if (!(emaAlpha > 0.f && emaAlpha <= 1.f)) {
+        problem = "emaAlpha must be in (0, 1]";
+    } else if (highCongestion < 0 || extremeCongestion < highCongestion) {
+        problem = "congestion thresholds must satisfy 0 <= highCongestion <= extremeCongestion";
+    }
+    if (problem && reason) {
+        *reason = problem;
+    }
+    return problem == nullptr;
+}
+
+void TrafficManager::applyControllerSettings(const ControllerSettings& settings) {
+    greenTime = settings.greenTime;
+    yellowTime = settings.yellowTime;
+    currentGreenTime = settings.greenTime;
+    minGreen = settings.minGreen;
+    maxGreen = settings.maxGreen;
+    priorityHold = settings.priorityHold;
+    emaAlpha = settings.emaAlpha;
+    highCongestion = settings.highCongestion;
+    extremeCongestion = settings.extremeCongestion;
+}
+
+TrafficManager::TrafficManager(const SimConfig& config)
+    : topLeftLight(sf::Vector2f(310.f, 160.f), !config.headless),
+      topRightLight(sf::Vector2f(600.f, 160.f), !config.headless),
+      bottomLeftLight(sf::Vector2f(310.f, 440.f), !config.headless),
+      bottomRightLight(sf::Vector2f(600.f, 440.f), !config.headless),
       phase(Phase::NS_Green),
+      permittedMask(kPhaseMasks[static_cast<int>(Phase::NS_Green)]),
       phaseTimer(0.f),
-      greenTime(5.f),
-      yellowTime(2.f),
-      currentGreenTime(5.f),
-      minGreen(3.f),
-      maxGreen(10.f),
       queueNS(0),
       queueEW(0),
+      lanesPerApproach(std::clamp(config.lanesPerApproach, 1, kMaxLanes)),
       spawnTimer(0.f),
-      spawnInterval(1.f),
-      vehicleSpeed(120.f)
+      spawnInterval(config.spawnInterval),
+      verbose(config.verbose),
+      externalControl(config.externalControl),
+      roadMargin(config.roadMargin),
+      rng(config.seed != 0 ? config.seed : static_cast<std::uint64_t>(std::time(nullptr))),
+      learner(config.learner),
+      policyWatcher(config.policyWatcher),
+      qFunction(config.qFunction),
+      replay(config.replay)
 {
-    std::srand(static_cast<unsigned>(std::time(nullptr)));
-    // Load the Q‑table using our QTableLoader (returns a map with string keys)
-    qTable = QTableLoader::loadQTable("q_table.json");
+    std::string reason;
+    if (config.controller.isValid(&reason)) {
+        applyControllerSettings(config.controller);
+    } else {
+        std::cerr << "Invalid controller settings (" << reason << "); using the defaults" << std::endl;
+        applyControllerSettings(ControllerSettings());
+    }
+
+    // Load the Q‑table using our QTableLoader (converted to a dense table),
+    // unless a preloaded table is shared with us.
+    qTable = config.qTable;
+    quantizedTable = config.quantizedTable;
+    if (!qTable && !quantizedTable && QTableLoader::isQuantizedPolicyFile(config.qTablePath)) {
+        auto quantized = std::make_shared<QuantizedQTable>();
+        if (QTableLoader::loadQuantizedPolicyFile(config.qTablePath, *quantized)) {
+            quantizedTable = quantized;
+        }
+    }
+    if (learner || policyWatcher) {
+        quantizedTable.reset();
+    }
+    if (!qTable) {
+        qTable = quantizedTable ? std::make_shared<const DenseQTable>()
+                                : std::make_shared<const DenseQTable>(QTableLoader::loadDenseQTable(config.qTablePath));
+    }
+
+    for (auto& dirLanes : lanes)
+        for (auto& lane : dirLanes)
+            lane = std::make_shared<std::vector<Vehicle>>();
 
     // Logical grouping: NS group starts green, EW group red.
     topLeftLight.setState(LightState::Green);
@@ -46,80 +167,210 @@ TrafficManager::TrafficManager()
     bottomRightLight.setState(LightState::Red);
 }
 
-TrafficManager::~TrafficManager() {
-    for (auto v : vehicles) {
-        delete v;
+TrafficManager::~TrafficManager() = default;
+
+std::unique_ptr<TrafficManager> TrafficManager::fork() const {
+    std::unique_ptr<TrafficManager> child(new TrafficManager(*this));
+    child->verbose = false;
+    // The learner's queue has a single producer: the parent.
+    child->learner.reset();
+    child->replay.reset();
+    // The file stream cannot be shared between threads; the fork samples a stream-less window.
+    if (demand) {
+        child->demand = std::make_shared<DemandProfile>(demand->snapshot());
     }
+    return child;
+}
+
+std::vector<Vehicle>& TrafficManager::mutableLane(int d, int l) {
+    std::shared_ptr<std::vector<Vehicle>>& lane = lanes[d][l];
+    if (lane.use_count() > 1) {
+        // Shared with a fork (or its parent): take a private copy before writing.
+        lane = std::make_shared<std::vector<Vehicle>>(*lane);
+    } else {
+        // Sole owner, possibly because another thread just dropped its reference;
+        // make that thread's reads of the lane happen before our writes.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *lane;
+}
+
+float TrafficManager::getLaneCenter(Direction d, int lane) const {
+    int i = static_cast<int>(d);
+    return kLaneCoord[i] + kLaneOutward[i] * ((lanesPerApproach - 1) * 0.5f - lane) * kLaneSpacing;
 }
 
 void TrafficManager::applyRLDecision(const std::pair<int, int>& stateKey, const char* phaseLabel, int prevQueueNS, int prevQueueEW) {
-    std::string keyStr = stateToString(stateKey);
+    // --- Adjust Reward Scaling.
+    int queueReduction = (prevQueueNS + prevQueueEW) - (queueNS + queueEW);
+    lastReward = (queueReduction > 0) ? 5.0 * std::pow(queueReduction, 1.5) : -1.5;
+    // Recorded before the phase switches, so inline and external decisions observe the same.
+    decisionEndsNS = (phase == Phase::NS_Green || phase == Phase::NS_Yellow);
+    if (verbose) std::cout << "[DEBUG] Reward computed (Adaptive Scaling): " << lastReward << std::endl;
+
+    // The new decision's observation completes the previous decision's
+    // transition, whether its action came from this controller or applyAction().
+    float observation[kObservationSize];
+    getObservation(observation);
+    if (replay && hasLastDecision) {
+        ReplayRecord record = {};
+        std::copy(lastDecisionObservation, lastDecisionObservation + kObservationSize, record.observation);
+        std::copy(observation, observation + kObservationSize, record.next);
+        record.action = lastDecisionAction;
+        record.reward = static_cast<float>(lastReward);
+        lastReplayIndex = replay->append(record);
+        hasReplayRecord = true;
+    }
+
+    // Under external control the decision waits for applyAction().
+    if (externalControl) {
+        decisionPending = true;
+        pendingPhaseLabel = phaseLabel;
+        pendingPrevQueueNS = prevQueueNS;
+        pendingPrevQueueEW = prevQueueEW;
+        return;
+    }
+
+    // Online learning: the reward just computed completes the previous decision,
+    // and the decision is taken on the learner's latest table.
+    if (learner) {
+        if (hasLastDecision) {
+            learner->push({ lastDecisionState.first, lastDecisionState.second, lastDecisionAction,
+                            lastReward, stateKey.first, stateKey.second });
+        }
+        qTable = learner->policy();
+    } else if (policyWatcher) {
+        // A reloaded policy takes effect here; the previous table is released
+        // once this and every fork holding it have moved on.
+        qTable = policyWatcher->policy();
+    }
+
     int action = 0;  // Default action: 0 = no change
 
-    // Try to look up the state in the Q-table.
-    auto it = qTable.find(keyStr);
-    if (it != qTable.end()) {
-        const std::vector<double>& qValues = it->second;
-        action = std::distance(qValues.begin(), std::max_element(qValues.begin(), qValues.end()));
-        std::cout << "RL Decision (" << phaseLabel << ") for state " << keyStr 
+    // Look up the state in the Q-table: a direct index, no key is built. Queues
+    // beyond the table are clamped to its edge, as traffic_train and the online
+    // learner do when they update it, so a long queue reads the edge state's
+    // values rather than the unknown sentinel.
+    int nsStates = quantizedTable ? quantizedTable->nsStates() : qTable->nsStates();
+    int ewStates = quantizedTable ? quantizedTable->ewStates() : qTable->ewStates();
+    int ns = nsStates > 0 ? std::min(stateKey.first, nsStates - 1) : stateKey.first;
+    int ew = ewStates > 0 ? std::min(stateKey.second, ewStates - 1) : stateKey.second;
+    const double* qValues = qTable->values(ns, ew);
+    bool known = quantizedTable ? quantizedTable->isKnown(ns, ew) : DenseQTable::isKnown(qValues);
+    if (qFunction) {
+        action = qFunction->greedy(observation);
+        if (verbose) std::cout << "Q-function Decision (" << phaseLabel << ") for state " << stateToString(stateKey)
+                               << ": Action = " << action << std::endl;
+    } else if (known) {
+        // The quantized argmax compares codes directly; nothing is decoded.
+        action = quantizedTable ? quantizedTable->argmax(ns, ew) : DenseQTable::argmax(qValues);
+        if (verbose) std::cout << "RL Decision (" << phaseLabel << ") for state " << stateToString(stateKey) 
                   << ": Action = " << action << std::endl;
     } else {
-        std::cout << "No RL Q-values found for state " << keyStr << std::endl;
-        action = (std::rand() % 2) + 1;  // Explore between action 1 and 2
-        std::cout << "[DEBUG] Choosing random action: " << action << std::endl;
+        if (verbose) std::cout << "No RL Q-values found for state " << stateToString(stateKey) << std::endl;
+        action = (rng.nextInt(2)) + 1;  // Explore between action 1 and 2
+        if (verbose) std::cout << "[DEBUG] Choosing random action: " << action << std::endl;
     }
+    hasLastDecision = true;
+    lastDecisionState = stateKey;
+    lastDecisionAction = action;
+    std::copy(observation, observation + kObservationSize, lastDecisionObservation);
+    adjustGreenTime(action, phaseLabel, prevQueueNS, prevQueueEW);
+}
+
+void TrafficManager::getObservation(float* observation) const {
+    // Before the first decision there is no EMA yet; the queues stand in for it.
+    observation[ObsQueueNS] = queueNS / kObservationQueueScale;
+    observation[ObsQueueEW] = queueEW / kObservationQueueScale;
+    observation[ObsEmaNS] = (emaInitialized ? emaQueueNS : queueNS) / kObservationQueueScale;
+    observation[ObsEmaEW] = (emaInitialized ? emaQueueEW : queueEW) / kObservationQueueScale;
+    observation[ObsGreenTime] = currentGreenTime / kObservationGreenScale;
+    observation[ObsPhaseNS] = decisionEndsNS ? 1.f : 0.f;
+    // The demand profile's current flow when one drives spawning, else the fixed interval's rate.
+    float rate = demand ? demandRate : (spawnInterval > 0.f ? 1.f / spawnInterval : 0.f);
+    observation[ObsArrivalRate] = rate / kObservationRateScale;
+}
+
+void TrafficManager::applyAction(int action) {
+    if (!decisionPending) {
+        return;
+    }
+    decisionPending = false;
+    // Recorded like an inline decision, before the green time changes what is observed.
+    hasLastDecision = true;
+    lastDecisionState = {queueNS, queueEW};
+    lastDecisionAction = action;
+    getObservation(lastDecisionObservation);
+    if (verbose) std::cout << "External Decision (" << pendingPhaseLabel << ") for state "
+                           << stateToString({queueNS, queueEW}) << ": Action = " << action << std::endl;
+    adjustGreenTime(action, pendingPhaseLabel, pendingPrevQueueNS, pendingPrevQueueEW);
+}
+
+void TrafficManager::endEpisode() {
+    if (replay && hasReplayRecord) {
+        replay->markDone(lastReplayIndex);
+    }
+}
 
+bool TrafficManager::runToDecision(float dt, float maxSeconds) {
+    double deadline = simTime + maxSeconds;
+    while (!decisionPending && simTime < deadline) {
+        update(dt);
+    }
+    return decisionPending;
+}
+
+void TrafficManager::adjustGreenTime(int action, const char* phaseLabel, int prevQueueNS, int prevQueueEW) {
     // --- Exponential Moving Average (EMA) for queue trends (Faster Adaptation)
-    static float emaQueueNS = static_cast<float>(prevQueueNS);
-    static float emaQueueEW = static_cast<float>(prevQueueEW);
-    float emaAlpha = 0.8f;  // Increased to make smoothing more responsive
+    // Seeded from the previous queues on the first decision.
+    if (!emaInitialized) {
+        emaQueueNS = static_cast<float>(prevQueueNS);
+        emaQueueEW = static_cast<float>(prevQueueEW);
+        emaInitialized = true;
+    }
     emaQueueNS = emaAlpha * queueNS + (1 - emaAlpha) * emaQueueNS;
     emaQueueEW = emaAlpha * queueEW + (1 - emaAlpha) * emaQueueEW;
     std::pair<int, int> smoothedState = { 
         static_cast<int>(std::round(emaQueueNS)),
         static_cast<int>(std::round(emaQueueEW))
     };
-    std::cout << "[DEBUG] Smoothed state: " << stateToString(smoothedState) << std::endl;
-
-    // --- Adjust Reward Scaling.
-    int queueReduction = (prevQueueNS + prevQueueEW) - (queueNS + queueEW);
-    double reward = (queueReduction > 0) ? 5.0 * std::pow(queueReduction, 1.5) : -1.5;
-    std::cout << "[DEBUG] Reward computed (Adaptive Scaling): " << reward << std::endl;
+    if (verbose) std::cout << "[DEBUG] Smoothed state: " << stateToString(smoothedState) << std::endl;
 
-    // --- Set max green time based on congestion level
-    float maxGreenTime = 5.f; // Default base max
-    if (queueNS >= 9 || queueEW >= 9) {  
-        std::cout << "[DEBUG] Extreme congestion detected; reinforcing max green time to 8 sec." << std::endl;
-        maxGreenTime = 8.f;
-    } else if (queueNS >= 6 || queueEW >= 6) {  
-        std::cout << "[DEBUG] High congestion detected; capping max green time at 6 sec." << std::endl;
-        maxGreenTime = 6.f;
+    // --- Set max green time based on congestion level (5/6/8 s with the default maxGreen).
+    float highCap = std::max(minGreen, 0.75f * maxGreen);
+    float maxGreenTime = std::max(minGreen, 0.625f * maxGreen); // Default base max
+    if (queueNS >= extremeCongestion || queueEW >= extremeCongestion) {  
+        if (verbose) std::cout << "[DEBUG] Extreme congestion detected; reinforcing max green time to " << maxGreen << " sec." << std::endl;
+        maxGreenTime = maxGreen;
+    } else if (queueNS >= highCongestion || queueEW >= highCongestion) {  
+        if (verbose) std::cout << "[DEBUG] High congestion detected; capping max green time at " << highCap << " sec." << std::endl;
+        maxGreenTime = highCap;
     }
 
     // --- Now update currentGreenTime so it fully respects the new maxGreenTime.
     if (currentGreenTime < maxGreenTime) {
-        std::cout << "[DEBUG] Increasing green time to match new max limit." << std::endl;
+        if (verbose) std::cout << "[DEBUG] Increasing green time to match new max limit." << std::endl;
         currentGreenTime = maxGreenTime;
     } else {
         currentGreenTime = std::clamp(currentGreenTime, minGreen, maxGreenTime);
     }
 
     // --- Override Action 0 Only If Congestion is Increasing (AFTER setting maxGreenTime)
-    if ((queueNS >= 6 || queueEW >= 6) && action == 0) {
+    if ((queueNS >= highCongestion || queueEW >= highCongestion) && action == 0) {
         if (queueNS > prevQueueNS || queueEW > prevQueueEW) {  // Override only if congestion is rising
-            std::cout << "[DEBUG] High congestion worsening; forcing non-zero action." << std::endl;
-            action = (std::rand() % 2) + 1;
-            std::cout << "[DEBUG] Overriding RL action to: " << action << std::endl;
+            if (verbose) std::cout << "[DEBUG] High congestion worsening; forcing non-zero action." << std::endl;
+            action = (rng.nextInt(2)) + 1;
+            if (verbose) std::cout << "[DEBUG] Overriding RL action to: " << action << std::endl;
         }
     }
 
     // --- Immediate adjustment if the spawn interval was changed by the user.
     if (spawnIntervalChanged) {
-        std::cout << "[DEBUG] User changed congestion settings, forcing immediate green time update." << std::endl;
-        if (queueNS >= 9 || queueEW >= 9) {
-            maxGreenTime = 8.f;
-        } else if (queueNS >= 6 || queueEW >= 6) {
-            maxGreenTime = 6.f;
+        if (verbose) std::cout << "[DEBUG] User changed congestion settings, forcing immediate green time update." << std::endl;
+        if (queueNS >= extremeCongestion || queueEW >= extremeCongestion) {
+            maxGreenTime = maxGreen;
+        } else if (queueNS >= highCongestion || queueEW >= highCongestion) {
+            maxGreenTime = highCap;
         }
         currentGreenTime = maxGreenTime; // Immediately apply new max limit
         spawnIntervalChanged = false;    // Reset the flag
@@ -127,16 +378,16 @@ void TrafficManager::applyRLDecision(const std::pair<int, int>& stateKey, const
 
     // --- Mid-phase congestion adaptation for real-time response.
     if (currentGreenTime < maxGreenTime) {
-        std::cout << "[DEBUG] Adjusting green time dynamically mid-phase!" << std::endl;
+        if (verbose) std::cout << "[DEBUG] Adjusting green time dynamically mid-phase!" << std::endl;
         currentGreenTime = std::min(currentGreenTime + 1, maxGreenTime);
     }
 
     // --- Dynamic Green Time Adjustments based on congestion.
-    if (queueNS >= 6 || queueEW >= 6) { 
-        std::cout << "[DEBUG] High congestion detected; increasing green time." << std::endl;
+    if (queueNS >= highCongestion || queueEW >= highCongestion) { 
+        if (verbose) std::cout << "[DEBUG] High congestion detected; increasing green time." << std::endl;
         currentGreenTime = std::min(currentGreenTime + 1, maxGreenTime);
     } else if (queueNS < 3 && queueEW < 3) { 
-        std::cout << "[DEBUG] Low traffic detected; decreasing green time." << std::endl;
+        if (verbose) std::cout << "[DEBUG] Low traffic detected; decreasing green time." << std::endl;
         currentGreenTime = std::max(currentGreenTime - 1, minGreen + 1); // Avoid reducing too fast
     }
 
@@ -150,7 +401,7 @@ void TrafficManager::applyRLDecision(const std::pair<int, int>& stateKey, const
     // --- Final clamp of currentGreenTime.
     currentGreenTime = std::clamp(currentGreenTime, minGreen, maxGreenTime);
 
-    std::cout << "[DEBUG] " << phaseLabel << " phase - New green time set to: " 
+    if (verbose) std::cout << "[DEBUG] " << phaseLabel << " phase - New green time set to: " 
               << currentGreenTime << std::endl;
 }
 
@@ -163,19 +414,63 @@ void TrafficManager::setSpawnInterval(float newInterval) {
 }
 
 
+void TrafficManager::markPassedStopLine(Vehicle* v) {
+    v->setPassedStopLine(true);
+    metrics.vehiclesServed++;
+    if (!(permittedMask & v->getMovementBit()) && !v->isCommitted()) {
+        metrics.stopLineViolations++;
+    }
+    if (vehicleParams(v->getType()).priority) {
+        priorityCount[static_cast<int>(v->getApproach())]--;
+    }
+}
+
+void TrafficManager::servePriorityArrivals(int approach) {
+    if (priorityPending[approach] == 0) {
+        return;
+    }
+    // Every pending arrival gets its green now.
+    double latencySum = priorityPending[approach] * simTime - priorityArrivalSum[approach];
+    double oldestLatency = simTime - priorityEarliestArrival[approach];
+    metrics.preemptionLatencySum += latencySum;
+    metrics.preemptionSamples += priorityPending[approach];
+    metrics.preemptionLatencyMax = std::max(metrics.preemptionLatencyMax, oldestLatency);
+    priorityPending[approach] = 0;
+    priorityArrivalSum[approach] = 0.0;
+}
+
 void TrafficManager::updateLights(float dt) {
     phaseTimer += dt;
+
+    // Preemption: a green is cut short (through the normal yellow, and never
+    // before minGreen) when only the conflicting axis has priority vehicles
+    // approaching, and held, up to priorityHold beyond its planned length, while
+    // only its own axis has them.
+    int priorityNS = priorityCount[0] + priorityCount[1];
+    int priorityEW = priorityCount[2] + priorityCount[3];
+
     switch (phase) {
         case Phase::NS_Green:
+        {
             topLeftLight.setState(LightState::Green);
             bottomLeftLight.setState(LightState::Green);
             topRightLight.setState(LightState::Red);
             bottomRightLight.setState(LightState::Red);
-            if (phaseTimer >= currentGreenTime) {
+            bool preempt = priorityEW > 0 && priorityNS == 0 && phaseTimer >= minGreen;
+            bool hold = priorityNS > 0 && priorityEW == 0 && phaseTimer < currentGreenTime + priorityHold;
+            if (hold && phaseTimer >= currentGreenTime && phaseTimer - dt < currentGreenTime) {
+                metrics.priorityHolds++;  // The green is held past its planned end, once per green.
+            }
+            if ((phaseTimer >= currentGreenTime && !hold) || preempt) {
+                if (preempt && phaseTimer < currentGreenTime) {
+                    metrics.preemptions++;
+                    if (verbose) std::cout << "[DEBUG] Priority vehicle on EW; cutting NS green short." << std::endl;
+                }
                 phase = Phase::NS_Yellow;
                 phaseTimer = 0.f;
             }
             break;
+        }
         case Phase::NS_Yellow:
         {
             topLeftLight.setState(LightState::Yellow);
@@ -187,24 +482,37 @@ void TrafficManager::updateLights(float dt) {
                 int prevQueueEW = queueEW;
                 measureQueues();
                 std::pair<int,int> stateKey = {queueNS, queueEW};
-                std::cout << "[DEBUG] NS_Yellow phase - QueueNS: " << queueNS
+                if (verbose) std::cout << "[DEBUG] NS_Yellow phase - QueueNS: " << queueNS
                           << ", QueueEW: " << queueEW << std::endl;
                 applyRLDecision(stateKey, "NS_Yellow", prevQueueNS, prevQueueEW);
                 phase = Phase::EW_Green;
                 phaseTimer = 0.f;
+                servePriorityArrivals(static_cast<int>(Direction::LeftToRight));
+                servePriorityArrivals(static_cast<int>(Direction::RightToLeft));
             }
             break;
         }
         case Phase::EW_Green:
+        {
             topLeftLight.setState(LightState::Red);
             bottomLeftLight.setState(LightState::Red);
             topRightLight.setState(LightState::Green);
             bottomRightLight.setState(LightState::Green);
-            if (phaseTimer >= currentGreenTime) {
+            bool preempt = priorityNS > 0 && priorityEW == 0 && phaseTimer >= minGreen;
+            bool hold = priorityEW > 0 && priorityNS == 0 && phaseTimer < currentGreenTime + priorityHold;
+            if (hold && phaseTimer >= currentGreenTime && phaseTimer - dt < currentGreenTime) {
+                metrics.priorityHolds++;  // The green is held past its planned end, once per green.
+            }
+            if ((phaseTimer >= currentGreenTime && !hold) || preempt) {
+                if (preempt && phaseTimer < currentGreenTime) {
+                    metrics.preemptions++;
+                    if (verbose) std::cout << "[DEBUG] Priority vehicle on NS; cutting EW green short." << std::endl;
+                }
                 phase = Phase::EW_Yellow;
                 phaseTimer = 0.f;
             }
             break;
+        }
         case Phase::EW_Yellow:
         {
             topLeftLight.setState(LightState::Red);
@@ -216,54 +524,118 @@ void TrafficManager::updateLights(float dt) {
                 int prevQueueEW = queueEW;
                 measureQueues();
                 std::pair<int,int> stateKey = {queueNS, queueEW};
-                std::cout << "[DEBUG] EW_Yellow phase - QueueNS: " << queueNS
+                if (verbose) std::cout << "[DEBUG] EW_Yellow phase - QueueNS: " << queueNS
                           << ", QueueEW: " << queueEW << std::endl;
                 applyRLDecision(stateKey, "EW_Yellow", prevQueueNS, prevQueueEW);
                 phase = Phase::NS_Green;
                 phaseTimer = 0.f;
+                servePriorityArrivals(static_cast<int>(Direction::TopToBottom));
+                servePriorityArrivals(static_cast<int>(Direction::BottomToTop));
             }
             break;
         }
     }
+    std::uint64_t revoked = permittedMask & ~kPhaseMasks[static_cast<int>(phase)];
+    permittedMask = kPhaseMasks[static_cast<int>(phase)];
+    if (revoked) {
+        commitDilemmaZone(revoked);
+    }
     topLeftLight.update(dt);
     topRightLight.update(dt);
     bottomLeftLight.update(dt);
     bottomRightLight.update(dt);
 }
 
+void TrafficManager::commitDilemmaZone(std::uint64_t revoked) {
+    for (int d = 0; d < 4; ++d) {
+        if (!(revoked & approachMask(static_cast<Direction>(d)))) {
+            continue;
+        }
+        for (int l = 0; l < lanesPerApproach; ++l) {
+            // Vehicles still short of the line have not turned, so they are all in their approach's lanes.
+            const std::vector<Vehicle>& lane = *lanes[d][l];
+            bool first = true;  // Nearest vehicle still short of the line.
+            for (size_t i = 0; i < lane.size(); ++i) {
+                const Vehicle& v = lane[i];
+                if (v.hasPassedStopLine()) {
+                    continue;
+                }
+                bool front = first;
+                first = false;
+                if (!(revoked & v.getMovementBit())) {
+                    continue;
+                }
+                float toLine = kStopLineProgress[d] - progressAlong(v, d);
+                if (toLine < 0.f) {
+                    continue;
+                }
+                const VehicleParams& p = vehicleParams(v.getType());
+                float brakingDistance = v.getSpeed() * v.getSpeed() / (2.f * p.deceleration);
+                // A permissive movement waiting at the line for a gap clears as its green ends.
+                bool waitingForGap = front && (yieldingMovements() & v.getMovementBit()) && toLine < kYieldStopTolerance;
+                if (toLine < brakingDistance || waitingForGap) {
+                    mutableLane(d, l)[i].setCommitted(true);
+                }
+            }
+        }
+    }
+}
+
+std::uint64_t TrafficManager::movementsInConflictZone() const {
+    std::uint64_t zone = 0;
+    for (int d = 0; d < 4; ++d) {
+        // Opposing left turns cross this approach's path in the near half of the
+        // junction, which ends at the opposing approach's stop line.
+        int opposing = static_cast<int>(opposingApproach(static_cast<Direction>(d)));
+        float conflictEnd = 0.5f * (kStopLineProgress[d] - kStopLineProgress[opposing]);
+        for (int l = 0; l < lanesPerApproach; ++l) {
+            // Front to back: past the junction, in it, then approaching the line.
+            for (const Vehicle& v : *lanes[d][l]) {
+                if (static_cast<int>(v.getApproach()) != d) {
+                    continue;  // Turned in from another approach; already clear of the junction.
+                }
+                float progress = progressAlong(v, d);
+                if (v.hasPassedStopLine()) {
+                    if (!v.hasTurned() && progress < conflictEnd) {
+                        zone |= v.getMovementBit();
+                    }
+                    continue;
+                }
+                if (kStopLineProgress[d] - progress >= kYieldDistance + v.getSpeed() * kYieldGapSeconds) {
+                    break;
+                }
+                zone |= v.getMovementBit();
+            }
+        }
+    }
+    return zone;
+}
+
+// Speed below which a vehicle counts as queued.
+static constexpr float kQueuedSpeed = 5.f;
+
 // Returns true if the vehicle's speed is below the threshold (i.e., it is effectively stopped)
-bool isVehicleQueuedBySpeed(Vehicle* v) {
-    const float SPEED_THRESHOLD = 5.f; // Adjust this value based on your simulation units
-    return (v->speed < SPEED_THRESHOLD);
+bool isVehicleQueuedBySpeed(const Vehicle* v) {
+    return (v->speed < kQueuedSpeed);
 }
 
 void TrafficManager::measureQueues() {
     queueNS = 0;
     queueEW = 0;
 
-    // Separate vehicles by direction
-    std::vector<Vehicle*> topVec, bottomVec, leftVec, rightVec;
-    for (auto* v : vehicles) {
-        switch (v->getDirection()) {
-            case Direction::TopToBottom:   topVec.push_back(v);    break;
-            case Direction::BottomToTop:   bottomVec.push_back(v); break;
-            case Direction::LeftToRight:   leftVec.push_back(v);   break;
-            case Direction::RightToLeft:   rightVec.push_back(v);  break;
-        }
-    }
-
-    // Sort them by position so we can iterate from front to back
-    std::sort(topVec.begin(), topVec.end(),   [](auto* a, auto* b){return a->getY() < b->getY();});
-    std::sort(bottomVec.begin(), bottomVec.end(),[](auto* a, auto* b){return a->getY() > b->getY();});
-    std::sort(leftVec.begin(), leftVec.end(), [](auto* a, auto* b){return a->getX() < b->getX();});
-    std::sort(rightVec.begin(), rightVec.end(),[](auto* a, auto* b){return a->getX() > b->getX();});
-
-    // Helper to process each lane
-    auto processLane = [&](std::vector<Vehicle*>& lane, bool isNS) {
+    // Helper to process each lane. Lanes are read through their shared pointer;
+    // one is copied (after a fork) only when a vehicle in it crosses the stop
+    // line and must be marked, so the pointer is re-read for every vehicle.
+    auto processLane = [&](int d, int l, bool isNS) {
         bool frontIsStopped = false;
-        for (size_t i = 0; i < lane.size(); ++i) {
-            Vehicle* v = lane[i];
-            if (shouldStopVehicle(v) || isVehicleQueuedBySpeed(v) || frontIsStopped) {
+        for (size_t i = 0; i < lanes[d][l]->size(); ++i) {
+            bool crossing = false;
+            bool stopped = shouldStopVehicle((*lanes[d][l])[i], crossing);
+            if (crossing) {
+                markPassedStopLine(&mutableLane(d, l)[i]);
+            }
+            const Vehicle* v = &(*lanes[d][l])[i];
+            if (stopped || isVehicleQueuedBySpeed(v) || frontIsStopped) {
                 if (isNS) queueNS++;
                 else      queueEW++;
                 frontIsStopped = true;
@@ -273,16 +645,50 @@ void TrafficManager::measureQueues() {
         }
     };
 
-    processLane(topVec, true);
-    processLane(bottomVec, true);
-    processLane(leftVec, false);
-    processLane(rightVec, false);
+    // Lanes are already ordered from front to back, so each one is walked directly.
+    for (int d = 0; d < 4; ++d) {
+        bool isNS = isVertical(static_cast<Direction>(d));
+        for (int l = 0; l < lanesPerApproach; ++l) {
+            if (!lanes[d][l]->empty())
+                processLane(d, l, isNS);
+        }
+    }
+    metrics.maxQueue = std::max({ metrics.maxQueue, queueNS, queueEW });
+}
+
+bool TrafficManager::loadDemandProfile(const std::string& filename) {
+    auto profile = std::make_unique<DemandProfile>();
+    if (!profile->open(filename)) {
+        return false;
+    }
+    demand = std::move(profile);
+    for (float& acc : spawnAccum) acc = 0.f;
+    if (verbose) std::cout << "[DEBUG] Demand profile loaded from " << filename << std::endl;
+    return true;
+}
+
+void TrafficManager::spawnFromDemand(float dt) {
+    float flows[kDemandApproaches];
+    demand->sample(simTime, flows);
+    demandRate = 0.f;
+    for (int a = 0; a < kDemandApproaches; ++a) {
+        demandRate += flows[a] / 3600.f;
+        // Flows are vehicles per hour.
+        spawnAccum[a] += flows[a] * (dt / 3600.f);
+        while (spawnAccum[a] >= 1.f) {
+            spawnVehicle(a);
+            spawnAccum[a] -= 1.f;
+        }
+    }
 }
 
 void TrafficManager::spawnVehicle() {
-    int approach = std::rand() % 4;
+    spawnVehicle(rng.nextInt(4));
+}
+
+void TrafficManager::spawnVehicle(int approach) {
     VehicleType t = VehicleType::Normal;
-    int r = std::rand() % 8;
+    int r = rng.nextInt(8);
     switch (r) {
         case 0: t = VehicleType::Normal; break;
         case 1: t = VehicleType::Taxi; break;
@@ -293,154 +699,330 @@ void TrafficManager::spawnVehicle() {
         case 6: t = VehicleType::BlackViper; break;
         case 7: t = VehicleType::BigTruck; break;
     }
-    Vehicle* v = nullptr;
+    // Turning split: 20% left, 60% straight, 20% right.
+    int m = rng.nextInt(10);
+    Movement movement = (m < 2) ? Movement::Left : (m < 8) ? Movement::Straight : Movement::Right;
+
+    // Turning vehicles enter in the lane they turn from; others pick any lane.
+    Direction dir = static_cast<Direction>(approach);
+    int lane = requiredLane(movement, lanesPerApproach);
+    if (lane < 0) {
+        lane = rng.nextInt(lanesPerApproach);
+    }
+    float laneCoord = getLaneCenter(dir, lane);
+
+    sf::Vector2f start;
     if (approach == 0) {
-        v = new Vehicle(sf::Vector2f(390.f, -50.f), t, Direction::TopToBottom);
+        start = sf::Vector2f(laneCoord, -roadMargin);
     } else if (approach == 1) {
-        v = new Vehicle(sf::Vector2f(500.f, 650.f), t, Direction::BottomToTop);
+        start = sf::Vector2f(laneCoord, 600.f + roadMargin);
     } else if (approach == 2) {
-        v = new Vehicle(sf::Vector2f(-50.f, 250.f), t, Direction::LeftToRight);
+        start = sf::Vector2f(-roadMargin, laneCoord);
     } else {
-        v = new Vehicle(sf::Vector2f(950.f, 350.f), t, Direction::RightToLeft);
+        start = sf::Vector2f(900.f + roadMargin, laneCoord);
+    }
+    Vehicle v(start, t, dir, movement);
+    v.setLane(lane);
+    // Turning vehicles swing into the same-numbered lane of the exit direction.
+    v.setTurnPoint(getLaneCenter(exitDirection(dir, movement), lane));
+    // A new vehicle is always the last one in its lane.
+    mutableLane(approach, lane).push_back(v);
+    registerArrival(v);
+}
+
+void TrafficManager::registerArrival(const Vehicle& v) {
+    if (!vehicleParams(v.getType()).priority) {
+        return;
+    }
+    int approach = static_cast<int>(v.getApproach());
+    priorityCount[approach]++;
+    if (permittedMask & approachMask(v.getApproach())) {
+        // Its approach is already green: no preemption wait.
+        metrics.preemptionSamples++;
+    } else {
+        if (priorityPending[approach] == 0) {
+            priorityEarliestArrival[approach] = simTime;
+        }
+        priorityPending[approach]++;
+        priorityArrivalSum[approach] += simTime;
+    }
+}
+
+void TrafficManager::populate(int count) {
+    // Queue vehicles back from each stop line, one lane at a time in round-robin
+    // order, as far as the approaches reach.
+    const float spacing = 90.f;
+    int placed = 0;
+    for (int row = 0; placed < count; ++row) {
+        bool anyRoom = false;
+        for (int approach = 0; approach < 4 && placed < count; ++approach) {
+            Direction dir = static_cast<Direction>(approach);
+            float progress = kStopLineProgress[approach] - row * spacing;
+            float entry = kTravelSign[approach] < 0.f
+                ? -(isVertical(dir) ? 600.f + roadMargin : 900.f + roadMargin)
+                : -roadMargin;
+            if (progress < entry) {
+                continue;
+            }
+            anyRoom = true;
+            for (int lane = 0; lane < lanesPerApproach && placed < count; ++lane) {
+                VehicleType t = static_cast<VehicleType>(rng.nextInt(kVehicleTypeCount));
+                int m = rng.nextInt(10);
+                Movement movement = (m < 2) ? Movement::Left : (m < 8) ? Movement::Straight : Movement::Right;
+                int required = requiredLane(movement, lanesPerApproach);
+                if (required >= 0 && required != lane) {
+                    movement = Movement::Straight;
+                }
+                float along = kTravelSign[approach] * progress;
+                float across = getLaneCenter(dir, lane);
+                sf::Vector2f pos = isVertical(dir) ? sf::Vector2f(across, along) : sf::Vector2f(along, across);
+                Vehicle v(pos, t, dir, movement);
+                v.speed = 0.f;
+                v.setLane(lane);
+                v.setTurnPoint(getLaneCenter(exitDirection(dir, movement), lane));
+                insertByProgress(mutableLane(approach, lane), v);
+                registerArrival(v);
+                ++placed;
+            }
+        }
+        if (!anyRoom) {
+            break;
+        }
     }
-    vehicles.push_back(v);
 }
 
-bool TrafficManager::shouldStopVehicle(Vehicle* v)
+bool TrafficManager::shouldStopVehicle(const Vehicle& v, bool& crossing) const
 {
+    crossing = false;
     // If the vehicle has been stopped for at least 2 seconds, count it as queued
     // (this helps catch vehicles that remain stopped even after crossing the line).
-    if (v->stoppedTime >= 2.0f) {
+    if (v.stoppedTime >= 2.0f) {
         return true;
     }
 
-    float x = v->getX();
-    float y = v->getY();
-    Direction d = v->getDirection();
-
     // If the vehicle was already marked as having passed the stop line
     // AND it's not forced to stop, we won't count it as queued anymore.
     // (Because typically it has cleared or is clearing the intersection.)
-    if (v->hasPassedStopLine()) {
+    if (v.hasPassedStopLine()) {
         return false;
     }
 
-    // Otherwise, check each approach with your existing thresholds:
-    if (d == Direction::TopToBottom) {
-        // Once y > 150.f, the vehicle is at/near the intersection
-        if (y > 150.f) {
-            LightState s = topLeftLight.getState();
-            // If red or yellow, the vehicle must stop => still queued
-            if (s == LightState::Red || s == LightState::Yellow) {
-                return true;
-            } else {
-                // Green => let it pass, mark as passedStopLine
-                v->setPassedStopLine(true);
-                return false;
-            }
+    // Only vehicles past their approach's stop-line threshold are at the intersection.
+    int a = static_cast<int>(v.getApproach());
+    float coord = isVertical(v.getApproach()) ? v.getY() : v.getX();
+    if (kTravelSign[a] * coord > kStopLineProgress[a]) {
+        // Permission is a single mask test against the current phase; a vehicle
+        // committed when its permission ended crosses as if still permitted.
+        if ((permittedMask & v.getMovementBit()) || v.isCommitted()) {
+            crossing = true;
+            return false;
         }
+        // Not permitted (red or yellow) => the vehicle must stop, still queued.
+        return true;
     }
-    else if (d == Direction::BottomToTop) {
-        if (y < 450.f) {
-            LightState s = bottomLeftLight.getState();
-            if (s == LightState::Red || s == LightState::Yellow) {
-                return true;
-            } else {
-                v->setPassedStopLine(true);
-                return false;
-            }
+
+    // If none of the above conditions apply (vehicle not near intersection), it's not queued
+    return false;
+}
+
+void TrafficManager::update(float dt) {
+    simTime += dt;
+    updateLights(dt);
+    if (demand) {
+        spawnFromDemand(dt);
+    } else {
+        spawnTimer += dt;
+        if (spawnTimer >= spawnInterval) {
+            spawnVehicle();
+            spawnTimer = 0.f;
         }
     }
-    else if (d == Direction::LeftToRight) {
-        if (x > 300.f) {
-            LightState s = topRightLight.getState();
-            if (s == LightState::Red || s == LightState::Yellow) {
-                return true;
-            } else {
-                v->setPassedStopLine(true);
-                return false;
+    changeLanes();
+
+    // Only needed while a permissive movement may go.
+    std::uint64_t conflictZone = (permittedMask & yieldingMovements()) ? movementsInConflictZone() : 0;
+
+    for (int d = 0; d < 4; ++d) {
+        for (int l = 0; l < lanesPerApproach; ++l) {
+            if (lanes[d][l]->empty())
+                continue;
+            std::vector<Vehicle>& lane = mutableLane(d, l);
+            // Front to back: each vehicle only looks at the one directly ahead.
+            // Class parameters are looked up by type index, with no per-type branching.
+            for (size_t i = 0; i < lane.size(); ++i) {
+                Vehicle* current = &lane[i];
+                const VehicleParams& p = vehicleParams(current->getType());
+                float progress = progressAlong(*current, d);
+
+                // Furthest point the vehicle's centre may reach: behind the leader...
+                float limit = 1e9f;
+                if (i > 0) {
+                    const Vehicle& leader = lane[i - 1];
+                    limit = progressAlong(leader, d) - p.minGap -
+                            0.5f * (vehicleParams(leader.getType()).length + p.length);
+                }
+
+                // ...and at the stop line unless the movement is permitted, or the
+                // vehicle was committed to crossing when its permission ended. A
+                // permitted permissive movement also waits there for a gap.
+                if (!current->hasPassedStopLine()) {
+                    int movement = movementIndex(current->getApproach(), current->getMovement());
+                    bool mayCross = current->isCommitted() ||
+                                    ((permittedMask & current->getMovementBit()) && !(kYieldMatrix[movement] & conflictZone));
+                    if (mayCross) {
+                        if (kStopLineProgress[d] - progress <= 0.f)
+                            markPassedStopLine(current);
+                    } else {
+                        limit = std::min(limit, kStopLineProgress[d]);
+                    }
+                }
+
+                // Accelerate towards the desired speed, capped by the speed from
+                // which the vehicle can still brake to a halt within the gap.
+                float gap = std::max(limit - progress, 0.f);
+                float speed = std::min({ current->getSpeed() + p.acceleration * dt,
+                                         p.desiredSpeed,
+                                         std::sqrt(2.f * p.deceleration * gap) });
+                float advance = std::min(speed * dt, gap);
+                if (speed < kQueuedSpeed && !current->hasPassedStopLine())
+                    metrics.delaySum += dt;
+                current->update(dt, dt > 0.f ? advance / dt : 0.f);
             }
         }
     }
-    else { // RightToLeft
-        if (x < 605.f) {
-            LightState s = bottomRightLight.getState();
-            if (s == LightState::Red || s == LightState::Yellow) {
-                return true;
-            } else {
-                v->setPassedStopLine(true);
-                return false;
-            }
+
+    // Drop vehicles that left the screen and pull out the ones that turned
+    // this tick; both sit near the front of their lane.
+    std::vector<Vehicle> turnedVehicles;
+    for (int d = 0; d < 4; ++d) {
+        for (int l = 0; l < lanesPerApproach; ++l) {
+            if (lanes[d][l]->empty())
+                continue;
+            std::vector<Vehicle>& lane = mutableLane(d, l);
+            lane.erase(
+                std::remove_if(lane.begin(), lane.end(), [&](Vehicle& v) {
+                    float xx = v.getX();
+                    float yy = v.getY();
+                    if (xx < -roadMargin || xx > 900.f + roadMargin ||
+                        yy < -roadMargin || yy > 600.f + roadMargin) {
+                        if (!v.hasPassedStopLine())
+                            markPassedStopLine(&v);
+                        return true;
+                    }
+                    if (static_cast<int>(v.getDirection()) != d) {
+                        turnedVehicles.push_back(v);
+                        return true;
+                    }
+                    return false;
+                }),
+                lane.end()
+            );
         }
     }
+    for (const Vehicle& v : turnedVehicles) {
+        insertByProgress(mutableLane(static_cast<int>(v.getDirection()), v.getLane()), v);
+    }
+}
 
-    // If none of the above conditions apply (vehicle not near intersection), it's not queued
-    return false;
+void TrafficManager::insertByProgress(std::vector<Vehicle>& lane, const Vehicle& v) {
+    float p = progressOf(v);
+    auto pos = std::upper_bound(lane.begin(), lane.end(), p,
+                                [](float value, const Vehicle& other) { return value > progressOf(other); });
+    lane.insert(pos, v);
 }
 
-void TrafficManager::update(float dt) {
-    updateLights(dt);
-    spawnTimer += dt;
-    if (spawnTimer >= spawnInterval) {
-        spawnVehicle();
-        spawnTimer = 0.f;
-    }
-    float minDistance = 80.f;
-    std::vector<Vehicle*> topVec, bottomVec, leftVec, rightVec;
-    for (auto* veh : vehicles) {
-        switch (veh->getDirection()) {
-            case Direction::TopToBottom:   topVec.push_back(veh); break;
-            case Direction::BottomToTop:   bottomVec.push_back(veh); break;
-            case Direction::LeftToRight:   leftVec.push_back(veh); break;
-            case Direction::RightToLeft:   rightVec.push_back(veh); break;
-        }
-    }
-    std::sort(topVec.begin(), topVec.end(), [](Vehicle* a, Vehicle* b) {
-        return a->getY() < b->getY();
-    });
-    std::sort(bottomVec.begin(), bottomVec.end(), [](Vehicle* a, Vehicle* b) {
-        return a->getY() > b->getY();
-    });
-    std::sort(leftVec.begin(), leftVec.end(), [](Vehicle* a, Vehicle* b) {
-        return a->getX() < b->getX();
-    });
-    std::sort(rightVec.begin(), rightVec.end(), [](Vehicle* a, Vehicle* b) {
-        return a->getX() > b->getX();
-    });
-    auto updateGroup = [&](std::vector<Vehicle*>& group, bool vertical) {
-        for (size_t i = 0; i < group.size(); ++i) {
-            Vehicle* current = group[i];
-            bool canMove = true;
-            if (shouldStopVehicle(current))
-                canMove = false;
-            if (i + 1 < group.size()) {
-                Vehicle* front = group[i + 1];
-                float dist = vertical ? (front->getY() - current->getY())
-                                      : (front->getX() - current->getX());
-                if (dist < 0) dist = -dist;
-                if (dist < minDistance)
-                    canMove = false;
-            }
-            if (canMove)
-                current->update(dt, vehicleSpeed);
+void TrafficManager::changeLanes() {
+    if (lanesPerApproach < 2) {
+        return;
+    }
+    // Alternate the sweep direction every tick so that a lane only receives
+    // vehicles from one neighbour per pass. Lanes are visited so that a vehicle
+    // moved into a lane is never considered again in the same pass.
+    int step = (laneChangeTick++ % 2 == 0) ? 1 : -1;
+    for (int d = 0; d < 4; ++d) {
+        if (step > 0) {
+            for (int l = lanesPerApproach - 2; l >= 0; --l)
+                changeLanesBetween(d, l, l + 1);
+        } else {
+            for (int l = 1; l < lanesPerApproach; ++l)
+                changeLanesBetween(d, l, l - 1);
         }
-    };
-    updateGroup(topVec, true);
-    updateGroup(bottomVec, true);
-    updateGroup(leftVec, false);
-    updateGroup(rightVec, false);
-    vehicles.erase(
-        std::remove_if(vehicles.begin(), vehicles.end(), [&](Vehicle* v) {
-            float xx = v->getX();
-            float yy = v->getY();
-            if (xx < -50.f || xx > 950.f || yy < -50.f || yy > 650.f) {
-                delete v;
-                return true;
-            }
-            return false;
-        }),
-        vehicles.end()
-    );
+    }
+}
+
+void TrafficManager::changeLanesBetween(int d, int from, int to) {
+    // The lanes are only read until a vehicle actually changes lane.
+    const std::vector<Vehicle>& src = *lanes[d][from];
+    const std::vector<Vehicle>& dst = *lanes[d][to];
+    std::vector<Vehicle> incoming;
+    std::vector<size_t> moved;
+
+    // Both lanes are sorted front to back, so a single merge-style walk finds
+    // every candidate's would-be leader and follower in the target lane.
+    size_t j = 0;
+    for (size_t i = 0; i < src.size(); ++i) {
+        const Vehicle& v = src[i];
+        // Only vehicles still approaching the stop line change lanes.
+        if (v.hasPassedStopLine()) {
+            continue;
+        }
+        float p = progressAlong(v, d);
+        while (j < dst.size() && progressAlong(dst[j], d) >= p) {
+            ++j;
+        }
+
+        bool wants;
+        int required = requiredLane(v.getMovement(), lanesPerApproach);
+        if (required >= 0) {
+            // Turning vehicles head for the lane they must turn from.
+            wants = (required - from) * (to - from) > 0;
+        } else {
+            // Straight-through vehicles move when the target lane has clearly fewer vehicles ahead.
+            wants = j + 1 < i;
+        }
+        if (!wants) {
+            continue;
+        }
+
+        // Gap acceptance against the leader and follower in the target lane,
+        // counting vehicles already accepted into it this pass. Those are all
+        // ahead of this one, and the last accepted is the nearest of them.
+        bool leadOk = (j == 0) || progressAlong(dst[j - 1], d) - p >= kLaneChangeGap;
+        leadOk = leadOk && (incoming.empty() || progressAlong(incoming.back(), d) - p >= kLaneChangeGap);
+        bool lagOk = (j >= dst.size()) || p - progressAlong(dst[j], d) >= kLaneChangeGap;
+        if (leadOk && lagOk) {
+            incoming.push_back(v);
+            incoming.back().moveToLane(to, getLaneCenter(static_cast<Direction>(d), to));
+            moved.push_back(i);
+        }
+    }
+
+    if (incoming.empty()) {
+        return;
+    }
+    // Compact the source lane around the vehicles that left it.
+    std::vector<Vehicle>& out = mutableLane(d, from);
+    size_t write = 0;
+    size_t next = 0;
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (next < moved.size() && moved[next] == i) {
+            ++next;
+            continue;
+        }
+        if (write != i) {
+            out[write] = out[i];
+        }
+        ++write;
+    }
+    out.erase(out.begin() + write, out.end());
+
+    // The merged lane replaces the target outright, so a shared target is never copied.
+    const std::vector<Vehicle>& target = *lanes[d][to];
+    auto merged = std::make_shared<std::vector<Vehicle>>();
+    merged->reserve(target.size() + incoming.size());
+    std::merge(target.begin(), target.end(), incoming.begin(), incoming.end(), std::back_inserter(*merged),
+               [d](const Vehicle& a, const Vehicle& b) { return progressAlong(a, d) > progressAlong(b, d); });
+    lanes[d][to] = std::move(merged);
 }
 
 void TrafficManager::render(sf::RenderWindow& window) {
@@ -448,11 +1030,301 @@ void TrafficManager::render(sf::RenderWindow& window) {
     topRightLight.render(window);
     bottomLeftLight.render(window);
     bottomRightLight.render(window);
-    for (auto* v : vehicles)
-        v->render(window);
+    for (auto& dirLanes : lanes)
+        for (auto& lane : dirLanes)
+            for (const auto& v : *lane)
+                v.render(window);
 }
 
 size_t TrafficManager::getVehicleCount() const {
-    return vehicles.size();
+    size_t count = 0;
+    for (auto& dirLanes : lanes)
+        for (auto& lane : dirLanes)
+            count += lane->size();
+    return count;
 }
 
+
+// --- Checkpoints ---------------------------------------------------------
+// A checkpoint is one contiguous block: header, controller state, lane sizes,
+// then every vehicle as a raw record in lane order. Vehicles are trivially
+// copyable, so both saving and restoring are straight memcpys. Restoring checks
+// the checksum and every record before anything is replaced.
+
+namespace {
+
+constexpr std::uint32_t kCheckpointVersion = 9;
+
+struct CheckpointHeader {
+    char magic[4];                 // "TMCK"
+    std::uint32_t version;
+    std::uint32_t vehicleSize;     // sizeof(Vehicle) when written; guards against layout changes.
+    std::uint32_t lanesPerApproach;
+    std::uint64_t vehicleCount;
+    std::uint64_t checksum;        // FNV-1a 64 of everything after the header.
+};
+
+struct ControllerState {
+    std::int32_t phase;
+    std::uint32_t laneChangeTick;
+    std::uint64_t permittedMask;
+    float phaseTimer, greenTime, yellowTime;
+    float currentGreenTime, minGreen, maxGreen, priorityHold;
+    float emaAlpha;
+    std::int32_t highCongestion, extremeCongestion;
+    std::int32_t queueNS, queueEW;
+    float spawnTimer, spawnInterval;
+    float spawnAccum[kDemandApproaches];
+    double simTime;
+    std::int32_t priorityCount[4];
+    std::int32_t priorityPending[4];
+    double priorityArrivalSum[4];
+    double priorityEarliestArrival[4];
+    SimMetrics metrics;
+    float emaQueueNS, emaQueueEW;
+    std::uint8_t emaInitialized, spawnIntervalChanged;
+    std::uint64_t rngState;
+    // Decision in flight: the learner's and replay log's previous decision, and
+    // the one awaiting applyAction() under external control.
+    std::int32_t lastDecisionNS, lastDecisionEW, lastDecisionAction;
+    float lastDecisionObservation[kObservationSize];
+    std::int32_t pendingPrevQueueNS, pendingPrevQueueEW;
+    double lastReward;
+    std::uint8_t hasLastDecision, decisionPending, decisionEndsNS;
+};
+
+}  // namespace
+
+static_assert(std::is_trivially_copyable<Vehicle>::value, "Checkpoints copy vehicles as raw bytes");
+static_assert(std::is_trivially_copyable<SimMetrics>::value, "Checkpoints copy metrics as raw bytes");
+
+std::vector<char> TrafficManager::checkpoint() const {
+    size_t vehicleCount = getVehicleCount();
+    std::uint32_t laneSizes[4][kMaxLanes] = {};
+    for (int d = 0; d < 4; ++d)
+        for (int l = 0; l < kMaxLanes; ++l)
+            laneSizes[d][l] = static_cast<std::uint32_t>(lanes[d][l]->size());
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, "TMCK", 4);
+    header.version = kCheckpointVersion;
+    header.vehicleSize = sizeof(Vehicle);
+    header.lanesPerApproach = static_cast<std::uint32_t>(lanesPerApproach);
+    header.vehicleCount = vehicleCount;
+
+    ControllerState state{};
+    state.phase = static_cast<std::int32_t>(phase);
+    state.laneChangeTick = laneChangeTick;
+    state.permittedMask = permittedMask;
+    state.phaseTimer = phaseTimer;
+    state.greenTime = greenTime;
+    state.yellowTime = yellowTime;
+    state.currentGreenTime = currentGreenTime;
+    state.minGreen = minGreen;
+    state.maxGreen = maxGreen;
+    state.priorityHold = priorityHold;
+    state.emaAlpha = emaAlpha;
+    state.highCongestion = highCongestion;
+    state.extremeCongestion = extremeCongestion;
+    state.queueNS = queueNS;
+    state.queueEW = queueEW;
+    state.spawnTimer = spawnTimer;
+    state.spawnInterval = spawnInterval;
+    std::memcpy(state.spawnAccum, spawnAccum, sizeof(spawnAccum));
+    state.simTime = simTime;
+    std::memcpy(state.priorityCount, priorityCount, sizeof(priorityCount));
+    std::memcpy(state.priorityPending, priorityPending, sizeof(priorityPending));
+    std::memcpy(state.priorityArrivalSum, priorityArrivalSum, sizeof(priorityArrivalSum));
+    std::memcpy(state.priorityEarliestArrival, priorityEarliestArrival, sizeof(priorityEarliestArrival));
+    state.metrics = metrics;
+    state.emaQueueNS = emaQueueNS;
+    state.emaQueueEW = emaQueueEW;
+    state.emaInitialized = emaInitialized;
+    state.spawnIntervalChanged = spawnIntervalChanged;
+    state.rngState = rng.state;
+    state.lastDecisionNS = lastDecisionState.first;
+    state.lastDecisionEW = lastDecisionState.second;
+    state.lastDecisionAction = lastDecisionAction;
+    std::memcpy(state.lastDecisionObservation, lastDecisionObservation, sizeof(lastDecisionObservation));
+    state.pendingPrevQueueNS = pendingPrevQueueNS;
+    state.pendingPrevQueueEW = pendingPrevQueueEW;
+    state.lastReward = lastReward;
+    state.hasLastDecision = hasLastDecision;
+    state.decisionPending = decisionPending;
+    state.decisionEndsNS = decisionEndsNS;
+
+    std::vector<char> buffer(sizeof(header) + sizeof(state) + sizeof(laneSizes) +
+                             vehicleCount * sizeof(Vehicle));
+    char* out = buffer.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    std::memcpy(out, &state, sizeof(state));
+    out += sizeof(state);
+    std::memcpy(out, laneSizes, sizeof(laneSizes));
+    out += sizeof(laneSizes);
+    for (int d = 0; d < 4; ++d) {
+        for (int l = 0; l < kMaxLanes; ++l) {
+            size_t bytes = lanes[d][l]->size() * sizeof(Vehicle);
+            if (bytes > 0) {
+                std::memcpy(out, lanes[d][l]->data(), bytes);
+                out += bytes;
+            }
+        }
+    }
+    header.checksum = fnv1a64(buffer.data() + sizeof(header), buffer.size() - sizeof(header));
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    return buffer;
+}
+
+bool TrafficManager::restore(const char* data, size_t size) {
+    CheckpointHeader header{};
+    ControllerState state{};
+    std::uint32_t laneSizes[4][kMaxLanes] = {};
+    size_t fixed = sizeof(header) + sizeof(state) + sizeof(laneSizes);
+    if (size < fixed) {
+        std::cerr << "Checkpoint is truncated" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, "TMCK", 4) != 0 || header.version != kCheckpointVersion ||
+        header.vehicleSize != sizeof(Vehicle) || header.lanesPerApproach < 1 ||
+        header.lanesPerApproach > static_cast<std::uint32_t>(kMaxLanes) ||
+        (size - fixed) % sizeof(Vehicle) != 0 || (size - fixed) / sizeof(Vehicle) != header.vehicleCount) {
+        std::cerr << "Checkpoint is not compatible with this build" << std::endl;
+        return false;
+    }
+    if (fnv1a64(data + sizeof(header), size - sizeof(header)) != header.checksum) {
+        std::cerr << "Checkpoint checksum mismatch" << std::endl;
+        return false;
+    }
+    std::memcpy(&state, data + sizeof(header), sizeof(state));
+    if (state.phase < static_cast<std::int32_t>(Phase::NS_Green) ||
+        state.phase > static_cast<std::int32_t>(Phase::EW_Yellow)) {
+        std::cerr << "Checkpoint has an invalid signal phase" << std::endl;
+        return false;
+    }
+    std::memcpy(laneSizes, data + sizeof(header) + sizeof(state), sizeof(laneSizes));
+    int laneCount = static_cast<int>(header.lanesPerApproach);
+    std::uint64_t total = 0;
+    for (int d = 0; d < 4; ++d) {
+        for (int l = 0; l < kMaxLanes; ++l) {
+            if (l >= laneCount && laneSizes[d][l] != 0) {
+                std::cerr << "Checkpoint has vehicles in a lane that does not exist" << std::endl;
+                return false;
+            }
+            total += laneSizes[d][l];
+        }
+    }
+    if (total != header.vehicleCount) {
+        std::cerr << "Checkpoint lane sizes do not match its vehicle count" << std::endl;
+        return false;
+    }
+
+    // The records are copied out (the buffer need not be aligned for Vehicle)
+    // and checked before they replace the current lanes.
+    std::shared_ptr<std::vector<Vehicle>> restored[4][kMaxLanes];
+    const char* records = data + fixed;
+    for (int d = 0; d < 4; ++d) {
+        for (int l = 0; l < kMaxLanes; ++l) {
+            auto lane = std::make_shared<std::vector<Vehicle>>(
+                laneSizes[d][l], Vehicle(sf::Vector2f(0.f, 0.f), VehicleType::Normal, static_cast<Direction>(d)));
+            size_t bytes = lane->size() * sizeof(Vehicle);
+            if (bytes > 0) {
+                std::memcpy(static_cast<void*>(lane->data()), records, bytes);
+                records += bytes;
+            }
+            for (const Vehicle& v : *lane) {
+                if (!v.isWellFormed() || static_cast<int>(v.getDirection()) != d || v.getLane() != l) {
+                    std::cerr << "Checkpoint has an invalid vehicle record" << std::endl;
+                    return false;
+                }
+            }
+            restored[d][l] = std::move(lane);
+        }
+    }
+
+    lanesPerApproach = laneCount;
+    for (int d = 0; d < 4; ++d)
+        for (int l = 0; l < kMaxLanes; ++l)
+            lanes[d][l] = std::move(restored[d][l]);
+
+    phase = static_cast<Phase>(state.phase);
+    laneChangeTick = state.laneChangeTick;
+    permittedMask = state.permittedMask;
+    phaseTimer = state.phaseTimer;
+    greenTime = state.greenTime;
+    yellowTime = state.yellowTime;
+    currentGreenTime = state.currentGreenTime;
+    minGreen = state.minGreen;
+    maxGreen = state.maxGreen;
+    priorityHold = state.priorityHold;
+    emaAlpha = state.emaAlpha;
+    highCongestion = state.highCongestion;
+    extremeCongestion = state.extremeCongestion;
+    queueNS = state.queueNS;
+    queueEW = state.queueEW;
+    spawnTimer = state.spawnTimer;
+    spawnInterval = state.spawnInterval;
+    std::memcpy(spawnAccum, state.spawnAccum, sizeof(spawnAccum));
+    simTime = state.simTime;
+    std::memcpy(priorityCount, state.priorityCount, sizeof(priorityCount));
+    std::memcpy(priorityPending, state.priorityPending, sizeof(priorityPending));
+    std::memcpy(priorityArrivalSum, state.priorityArrivalSum, sizeof(priorityArrivalSum));
+    std::memcpy(priorityEarliestArrival, state.priorityEarliestArrival, sizeof(priorityEarliestArrival));
+    metrics = state.metrics;
+    emaQueueNS = state.emaQueueNS;
+    emaQueueEW = state.emaQueueEW;
+    emaInitialized = state.emaInitialized != 0;
+    spawnIntervalChanged = state.spawnIntervalChanged != 0;
+    rng.state = state.rngState;
+    lastDecisionState = {state.lastDecisionNS, state.lastDecisionEW};
+    lastDecisionAction = state.lastDecisionAction;
+    std::memcpy(lastDecisionObservation, state.lastDecisionObservation, sizeof(lastDecisionObservation));
+    pendingPrevQueueNS = state.pendingPrevQueueNS;
+    pendingPrevQueueEW = state.pendingPrevQueueEW;
+    lastReward = state.lastReward;
+    hasLastDecision = state.hasLastDecision != 0;
+    decisionPending = state.decisionPending != 0;
+    decisionEndsNS = state.decisionEndsNS != 0;
+    // Transitions logged before the restore do not belong to the restored run.
+    hasReplayRecord = false;
+    // The label only names the yellow the pending decision was taken in.
+    pendingPhaseLabel = decisionEndsNS ? "NS_Yellow" : "EW_Yellow";
+
+    // A demand profile is re-read from its start; sampling skips ahead to simTime.
+    if (demand) {
+        demand->rewind();
+        float flows[kDemandApproaches];
+        demand->sample(simTime, flows);
+        demandRate = 0.f;
+        for (float flow : flows) demandRate += flow / 3600.f;
+    }
+    return true;
+}
+
+bool TrafficManager::saveCheckpoint(const std::string& filename) const {
+    std::vector<char> buffer = checkpoint();
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to write checkpoint: " << filename << std::endl;
+        return false;
+    }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<bool>(file);
+}
+
+bool TrafficManager::loadCheckpoint(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open checkpoint: " << filename << std::endl;
+        return false;
+    }
+    // The whole checkpoint comes in with a single read.
+    std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+        std::cerr << "Unable to read checkpoint: " << filename << std::endl;
+        return false;
+    }
+    return restore(buffer.data(), buffer.size());
+}
@@ -3,26 +3,154 @@
 
 #include "TrafficLight.hpp"
 #include "Vehicle.hpp"
+#include "DemandProfile.hpp"
+#include "SimRng.hpp"
+#include "DenseQTable.hpp"
+#include "QuantizedQTable.hpp"
+#include "OnlineLearner.hpp"
+#include "PolicyWatcher.hpp"
+#include "QFunction.hpp"
+#include "ReplayBuffer.hpp"
 #include <SFML/Graphics.hpp>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <utility>
-#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Running performance counters of a simulation.
+struct SimMetrics {
+    int preemptions = 0;                // Greens cut short for priority vehicles on the other axis.
+    int priorityHolds = 0;              // Greens held past their planned end for priority vehicles.
+    int preemptionSamples = 0;          // Priority arrivals that have been served a green.
+    double preemptionLatencySum = 0.0;  // Seconds from arrival to green, summed over samples.
+    double preemptionLatencyMax = 0.0;
 
-// We'll store the Q‑table with keys as strings.
-using QTable = std::unordered_map<std::string, std::vector<double>>;
+    int vehiclesServed = 0;             // Vehicles that crossed their stop line.
+    int stopLineViolations = 0;         // Of those, crossings without permission or a dilemma-zone commitment; always 0.
+    double delaySum = 0.0;              // Seconds vehicles spent queued before their stop line.
+    int maxQueue = 0;                   // Longest NS or EW queue measured at a phase change.
+
+    double meanPreemptionLatency() const {
+        return preemptionSamples > 0 ? preemptionLatencySum / preemptionSamples : 0.0;
+    }
+    // Average queued time per served vehicle, in seconds.
+    double meanDelay() const {
+        return vehiclesServed > 0 ? delaySum / vehiclesServed : 0.0;
+    }
+};
+
+// Signal timing plan and controller thresholds. The defaults are the hand-tuned plan.
+struct ControllerSettings {
+    float greenTime = 5.f;       // Initial green time.
+    float yellowTime = 2.f;
+    float minGreen = 3.f;
+    // Adaptive green cap under extreme congestion; high congestion caps the
+    // green at 3/4 of it and other traffic at 5/8 (never below minGreen).
+    float maxGreen = 8.f;
+    float priorityHold = 10.f;   // Extra green a priority vehicle may hold beyond the planned green.
+    float emaAlpha = 0.8f;       // Weight of the newest queue in the queue EMA.
+    int highCongestion = 6;      // Queue length that counts as high congestion...
+    int extremeCongestion = 9;   // ...and as extreme congestion.
+
+    // False, with the reason, for settings the controller cannot run with
+    // (non-positive times, minGreen above maxGreen, ...).
+    bool isValid(std::string* reason = nullptr) const;
+};
+
+// Construction-time settings of a simulation.
+struct SimConfig {
+    int lanesPerApproach = 1;
+    bool headless = false;       // No textures are loaded; for batch and stress runs.
+    bool verbose = true;         // Print the per-decision debug log.
+    std::uint64_t seed = 0;      // Random seed; 0 seeds from the clock.
+    float roadMargin = 50.f;     // How far the approaches extend beyond the 900x600 view.
+    float spawnInterval = 1.f;   // Seconds between spawns when no demand profile is loaded.
+    ControllerSettings controller;
+    bool externalControl = false;  // Phase-end decisions wait for applyAction() (training).
+    std::string qTablePath = "q_table.json";  // JSON or binary policy file.
+    std::shared_ptr<const DenseQTable> qTable;  // Preloaded table shared between runs (optional).
+    // Quantized policy shared between runs (optional): decisions take the argmax
+    // of its codes instead of looking up qTable. Loaded automatically when
+    // qTablePath is a quantized policy file and no qTable is given. Ignored
+    // when a learner or policy watcher supplies the tables.
+    std::shared_ptr<const QuantizedQTable> quantizedTable;
+    // Online TD learning (optional): decisions feed this learner and act on the
+    // table it publishes. One simulation per learner; forks do not learn.
+    std::shared_ptr<OnlineLearner> learner;
+    // Hot-reloaded policy (optional): each decision acts on the watcher's latest table.
+    std::shared_ptr<PolicyWatcher> policyWatcher;
+    // Function-approximation policy (optional): decisions act on its values for
+    // the full observation instead of looking up the Q-table.
+    std::shared_ptr<const QFunction> qFunction;
+    // Persistent experience replay (optional): each decision, inline or through
+    // applyAction(), appends the previous one's transition. One simulation per
+    // buffer at a time; forks do not log.
+    std::shared_ptr<ReplayBuffer> replay;
+};
 
 class TrafficManager {
 public:
-    TrafficManager();
+    static constexpr int kMaxLanes = 3;
+
+    explicit TrafficManager(const SimConfig& config = SimConfig());
     ~TrafficManager();
 
     void update(float dt);
     void render(sf::RenderWindow& window);
     void setSpawnInterval(float newInterval);
     float getSpawnInterval() const { return spawnInterval; }
+    // Streams per-approach flows from a demand profile instead of the fixed interval.
+    bool loadDemandProfile(const std::string& filename);
+    bool hasDemandProfile() const { return demand != nullptr; }
+    double getSimTime() const { return simTime; }
+    const SimMetrics& getMetrics() const { return metrics; }
     size_t getVehicleCount() const;
+    // Fills the approach lanes with queued vehicles, e.g. to start a stress run from a loaded network.
+    void populate(int count);
+    void setVerbose(bool enabled) { verbose = enabled; }
+    // Restarts the random stream, e.g. to branch many runs off one checkpoint.
+    void reseed(std::uint64_t seed) { rng.state = seed; }
+
+    // Versioned binary checkpoint of the full simulation state: vehicles, signal
+    // phase and timers, controller (EMA) state, demand accumulators and RNG.
+    // The Q-table and demand profile are not included; they come from their own files.
+    std::vector<char> checkpoint() const;
+    bool restore(const char* data, size_t size);
+    bool saveCheckpoint(const std::string& filename) const;
+    bool loadCheckpoint(const std::string& filename);
+
+    // Copy-on-write child state for what-if rollouts (e.g. trying each signal
+    // decision a few cycles ahead). The fork shares every lane with this
+    // simulation and copies a lane only when either side first changes it, so
+    // forking itself copies no vehicles. Stepping moves (or ages) every vehicle,
+    // so the first update() on either side copies each occupied lane once. Forks
+    // are headless and quiet; each one may be stepped on its own thread while the
+    // parent keeps running. A demand profile is carried as its current two-bin window.
+    std::unique_ptr<TrafficManager> fork() const;
+
+    // External control, e.g. for training. With SimConfig::externalControl set, each
+    // phase-end decision pauses with the queues measured and the reward for the
+    // previous decision computed, until applyAction() supplies the action
+    // (0 = keep, 1 = +1 s green, 2 = -1 s green) in place of the Q-table's.
+    // runToDecision steps by dt until a decision is pending or maxSeconds pass.
+    bool runToDecision(float dt, float maxSeconds);
+    bool isDecisionPending() const { return decisionPending; }
+    void applyAction(int action);
+    // Marks the latest logged replay transition as ending its episode (done = 1),
+    // for callers that stop a run at a decision.
+    void endEpisode();
+    std::pair<int, int> getQueueState() const { return {queueNS, queueEW}; }
+    // Reward of the latest decision: shaped by how much the total queue shrank.
+    double getLastReward() const { return lastReward; }
+    // Observation of the current decision for function-approximation policies;
+    // writes kObservationSize floats (see QFunction.hpp).
+    void getObservation(float* observation) const;
+
+    int getLanesPerApproach() const { return lanesPerApproach; }
+    // Cross-axis coordinate of a lane centre (x for vertical directions, y for horizontal).
+    float getLaneCenter(Direction d, int lane) const;
 
 private:
     // Four traffic lights.
@@ -35,6 +163,9 @@ private:
     enum class Phase { NS_Green, NS_Yellow, EW_Green, EW_Yellow };
     Phase phase;
 
+    // Movements allowed to enter the intersection in the current phase (see Movements.hpp).
+    std::uint64_t permittedMask;
+
     // Timers & durations.
     float phaseTimer;
     float greenTime;    // Base green time.
@@ -44,30 +175,116 @@ private:
     float currentGreenTime;
     float minGreen;
     float maxGreen;
+    float priorityHold;
+
+    // Controller thresholds (see ControllerSettings).
+    float emaAlpha;
+    int highCongestion;
+    int extremeCongestion;
 
     // Queues for NS and EW.
     int queueNS;
     int queueEW;
 
-    // Vehicles.
-    std::vector<Vehicle*> vehicles;
+    // Vehicles, one array per lane of each direction of travel, ordered from
+    // the lead vehicle (furthest along) to the back of the lane. Lanes are shared
+    // with forks and must be written through mutableLane().
+    int lanesPerApproach;
+    std::shared_ptr<std::vector<Vehicle>> lanes[4][kMaxLanes];
+    unsigned laneChangeTick = 0;
 
     // Spawning logic.
     float spawnTimer;
     float spawnInterval;
-    float vehicleSpeed;
 
-    // --- NEW: Q-table loaded from JSON.
-    QTable qTable;
+    // Time-varying demand (optional). When set, each approach accumulates
+    // its interpolated flow and spawns a vehicle per whole unit.
+    std::shared_ptr<DemandProfile> demand;
+    float spawnAccum[kDemandApproaches] = {0.f, 0.f, 0.f, 0.f};
+    float demandRate = 0.f;  // Total flow of the latest sample, vehicles per second.
+    double simTime = 0.0;
+
+    // Signal preemption. Priority vehicles still approaching the stop line are
+    // counted per approach on spawn and on crossing the line, so detection never
+    // scans the lanes. Arrivals not yet served a green are kept as a count, a
+    // sum of arrival times and the earliest arrival to measure preemption latency.
+    int priorityCount[4] = {0, 0, 0, 0};
+    int priorityPending[4] = {0, 0, 0, 0};
+    double priorityArrivalSum[4] = {0.0, 0.0, 0.0, 0.0};
+    double priorityEarliestArrival[4] = {0.0, 0.0, 0.0, 0.0};
+    SimMetrics metrics;
+
+    bool verbose;
+    bool externalControl;
+    float roadMargin;
+    SimRng rng;
+
+    // --- NEW: Q-table loaded from JSON into a dense table (shared, read-only).
+    std::shared_ptr<const DenseQTable> qTable;
+    std::shared_ptr<const QuantizedQTable> quantizedTable;
+
+    // Online learning: the previous decision, completed into a Transition by the next one.
+    std::shared_ptr<OnlineLearner> learner;
+    bool hasLastDecision = false;
+    std::pair<int, int> lastDecisionState;
+    int lastDecisionAction = 0;
+
+    std::shared_ptr<PolicyWatcher> policyWatcher;
+    std::shared_ptr<const QFunction> qFunction;
+
+    // Replay logging: the previous decision's observation, completed by the next one.
+    std::shared_ptr<ReplayBuffer> replay;
+    float lastDecisionObservation[kObservationSize] = {};
+    bool hasReplayRecord = false;
+    std::uint64_t lastReplayIndex = 0;  // Index of the latest transition this simulation logged.
+
+    // Used by fork(); lanes and the Q-table are shared, everything else is copied.
+    TrafficManager(const TrafficManager&) = default;
+    TrafficManager& operator=(const TrafficManager&) = delete;
+
+    // Returns lane l of direction d for writing, first copying it if a fork still shares it.
+    std::vector<Vehicle>& mutableLane(int d, int l);
 
     void spawnVehicle();
+    void spawnVehicle(int approach);
+    void spawnFromDemand(float dt);
     void updateLights(float dt);
-    bool shouldStopVehicle(Vehicle* v);
+    // Whether v counts as queued. Reads only; crossing is set when v reaches the
+    // stop line on a permitted movement and must be marked as passed.
+    bool shouldStopVehicle(const Vehicle& v, bool& crossing) const;
+    void applyControllerSettings(const ControllerSettings& settings);
     void measureQueues();
+    void registerArrival(const Vehicle& v);
+    void markPassedStopLine(Vehicle* v);
+    // Decides the dilemma zone once, as the movements in revoked lose permission:
+    // vehicles on them that can no longer stop before the line are committed to cross.
+    void commitDilemmaZone(std::uint64_t revoked);
+    // Movements with a vehicle inside the junction or about to enter it, which
+    // the movements yielding to them must let pass (see kYieldMatrix).
+    std::uint64_t movementsInConflictZone() const;
+    void servePriorityArrivals(int approach);
+    void changeLanes();
+    void changeLanesBetween(int d, int from, int to);
+    void insertByProgress(std::vector<Vehicle>& lane, const Vehicle& v);
     bool spawnIntervalChanged = false;  // Track if the spawn interval was changed
 
+    // Queue EMA carried from one decision to the next.
+    float emaQueueNS = 0.f;
+    float emaQueueEW = 0.f;
+    bool emaInitialized = false;
+
+    // Decision awaiting applyAction() under external control.
+    bool decisionPending = false;
+    const char* pendingPhaseLabel = "";
+    int pendingPrevQueueNS = 0;
+    int pendingPrevQueueEW = 0;
+    double lastReward = 0.0;
+    bool decisionEndsNS = true;  // Phase group of the latest decision's ending green.
+
     // Logs the RL decision based on the current state.
     void applyRLDecision(const std::pair<int, int>& stateKey, const char* phaseLabel, int prevQueueNS, int prevQueueEW);
+    // Adapts the green time to the congestion level and the chosen action.
+    void adjustGreenTime(int action, const char* phaseLabel, int prevQueueNS, int prevQueueEW);
 };
 
 #endif
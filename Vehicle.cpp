@@ -1,70 +1,36 @@
 #include "Vehicle.hpp"
+#include "Movements.hpp"
+#include "VehicleClass.hpp"
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
 
 using namespace std;
 
-Vehicle::Vehicle(const sf::Vector2f& startPos, VehicleType type, Direction dir)
-    : type(type), direction(dir), textureLoaded(false), passedStopLine(false), stoppedTime(0.f) // initialize false
-
-{
-    lastPosition = startPos;
-    // Choose a texture file
-    std::string fileName = "C:/TrafficLightSimulation/assets/car.png";
-    switch (type) {
-        case VehicleType::Normal:    fileName = "C:/TrafficLightSimulation/assets/car.png"; break;
-        case VehicleType::Taxi:      fileName = "C:/TrafficLightSimulation/assets/taxi.png"; break;
-        case VehicleType::Ambulance: fileName = "C:/TrafficLightSimulation/assets/ambulance.png"; break;
-        case VehicleType::Audi:      fileName = "C:/TrafficLightSimulation/assets/Audi.png"; break;
-        case VehicleType::Truck:     fileName = "C:/TrafficLightSimulation/assets/mini_truck.png"; break;
-        case VehicleType::Bus:       fileName = "C:/TrafficLightSimulation/assets/police.png"; break;
-        case VehicleType::BlackViper:fileName = "C:/TrafficLightSimulation/assets/black_viper.png"; break;
-        case VehicleType::BigTruck:  fileName = "C:/TrafficLightSimulation/assets/truck.png"; break;
+// Sprite rotation for a direction of travel (car.png faces right by default).
+static float rotationFor(Direction dir) {
+    switch (dir) {
+        case Direction::LeftToRight: return 0.f;
+        case Direction::RightToLeft: return 180.f;
+        case Direction::TopToBottom: return 90.f;   // 90 degrees clockwise
+        case Direction::BottomToTop: return 270.f;  // 270 degrees clockwise (or -90)
     }
+    return 0.f;
+}
 
-    if (texture.loadFromFile(fileName)) {
-        textureLoaded = true;
-        sprite.setTexture(texture);
-        // Scale down if needed
-        sprite.setScale(0.3f, 0.3f);
-
-        // Center origin
-        sf::Vector2u texSize = texture.getSize();
-        sprite.setOrigin(texSize.x * 0.5f, texSize.y * 0.5f);
-
-        // Position
-        sprite.setPosition(startPos);
-
-        // Rotate based on direction
-        switch (dir) {
-            case Direction::LeftToRight:
-                // No rotation needed if your car.png faces right by default
-                sprite.setRotation(0.f);
-                break;
-            case Direction::RightToLeft:
-                // 180 degrees if your car.png is oriented to the right by default
-                sprite.setRotation(180.f);
-                break;
-            case Direction::TopToBottom:
-                // 90 degrees clockwise
-                sprite.setRotation(90.f);
-                break;
-            case Direction::BottomToTop:
-                // 270 degrees clockwise (or -90)
-                sprite.setRotation(270.f);
-                break;
-        }
-    } else {
-        std::cerr << "Failed to load vehicle image from " << fileName << "\n";
-        fallback.setSize(sf::Vector2f(40.f, 20.f));
-        fallback.setOrigin(20.f, 10.f);
-        fallback.setPosition(startPos);
-        fallback.setFillColor(sf::Color::Blue);
-    }
+Vehicle::Vehicle(const sf::Vector2f& startPos, VehicleType type, Direction dir, Movement movement)
+    : lastPosition(startPos), stoppedTime(0.f),
+      speed(vehicleParams(type).desiredSpeed),  // vehicles enter at cruising speed
+      position(startPos), movementBit(::movementBit(dir, movement)), turnAt(0.f), lane(0),
+      type(type), direction(dir), approach(dir), movement(movement), turned(false),
+      passedStopLine(false), // initialize false
+      committed(false)
+{
 }
 
 void Vehicle::update(float dt, float speed) {
+    this->speed = speed;
     float dx = 0.f;
     float dy = 0.f;
 
@@ -79,14 +45,25 @@ void Vehicle::update(float dt, float speed) {
     dx *= dt;
     dy *= dt;
 
-    if (textureLoaded) {
-        sprite.move(dx, dy);
-    } else {
-        fallback.move(dx, dy);
+    position.x += dx;
+    position.y += dy;
+
+    // Swing into the exit lane once the turn point is reached.
+    if (!turned && movement != Movement::Straight) {
+        bool reached = false;
+        switch (direction) {
+            case Direction::LeftToRight: reached = getX() >= turnAt; break;
+            case Direction::RightToLeft: reached = getX() <= turnAt; break;
+            case Direction::TopToBottom: reached = getY() >= turnAt; break;
+            case Direction::BottomToTop: reached = getY() <= turnAt; break;
+        }
+        if (reached) {
+            completeTurn();
+        }
     }
-    
+
     // Compute actual displacement from last frame.
-    sf::Vector2f currentPos = textureLoaded ? sprite.getPosition() : fallback.getPosition();
+    sf::Vector2f currentPos = position;
     float displacement = std::sqrt(std::pow(currentPos.x - lastPosition.x, 2) +
                                    std::pow(currentPos.y - lastPosition.y, 2));
     const float epsilon = 0.1f; 
@@ -102,36 +79,69 @@ void Vehicle::update(float dt, float speed) {
     lastPosition = currentPos;
 }
 
-void Vehicle::render(sf::RenderWindow& window) {
-    if (textureLoaded) {
-        window.draw(sprite);
+void Vehicle::completeTurn() {
+    // Snap onto the exit lane and head off in the new direction.
+    if (isVertical(direction)) {
+        position.y = turnAt;
     } else {
-        window.draw(fallback);
+        position.x = turnAt;
     }
+    direction = exitDirection(approach, movement);
+    turned = true;
 }
 
-VehicleType Vehicle::getType() const {
-    return type;
-}
-
-float Vehicle::getX() const {
-    // For sorting horizontally
-    if (textureLoaded) {
-        return sprite.getPosition().x;
+void Vehicle::moveToLane(int newLane, float coordinate) {
+    lane = newLane;
+    if (isVertical(direction)) {
+        position.x = coordinate;
     } else {
-        return fallback.getPosition().x;
+        position.y = coordinate;
     }
+    lastPosition = position;
 }
 
-float Vehicle::getY() const {
-    // For sorting vertically
-    if (textureLoaded) {
-        return sprite.getPosition().y;
+void Vehicle::render(sf::RenderWindow& window) const {
+    // One texture per vehicle class, shared by every vehicle and loaded the
+    // first time a vehicle of that class is drawn.
+    static sf::Texture textures[kVehicleTypeCount];
+    static bool attempted[kVehicleTypeCount] = {};
+    static bool loaded[kVehicleTypeCount] = {};
+
+    int t = static_cast<int>(type);
+    const VehicleParams& params = vehicleParams(type);
+    if (!attempted[t]) {
+        attempted[t] = true;
+        loaded[t] = textures[t].loadFromFile(params.texture);
+        if (!loaded[t]) {
+            std::cerr << "Failed to load vehicle image from " << params.texture << "\n";
+        }
+    }
+
+    if (loaded[t]) {
+        sf::Sprite sprite(textures[t]);
+        // Scale down if needed
+        sprite.setScale(params.renderScale, params.renderScale);
+        // Center origin
+        sf::Vector2u texSize = textures[t].getSize();
+        sprite.setOrigin(texSize.x * 0.5f, texSize.y * 0.5f);
+        sprite.setPosition(position);
+        // Rotate based on direction
+        sprite.setRotation(rotationFor(direction));
+        window.draw(sprite);
     } else {
-        return fallback.getPosition().y;
+        sf::RectangleShape fallback(sf::Vector2f(params.length, 20.f));
+        fallback.setOrigin(params.length * 0.5f, 10.f);
+        fallback.setPosition(position);
+        fallback.setRotation(rotationFor(direction));
+        fallback.setFillColor(sf::Color::Blue);
+        window.draw(fallback);
     }
 }
 
+VehicleType Vehicle::getType() const {
+    return type;
+}
+
 Direction Vehicle::getDirection() const {
     return direction;
 }
@@ -144,6 +154,27 @@ void Vehicle::setPassedStopLine(bool val) {
     passedStopLine = val;
 }
 
+// Flags are read as raw bytes: a bool holding anything but 0 or 1 must not be used as one.
+static bool isFlagByte(const bool& flag) {
+    unsigned char byte;
+    std::memcpy(&byte, &flag, 1);
+    return byte <= 1;
+}
+
+bool Vehicle::isWellFormed() const {
+    if (static_cast<int>(type) >= kVehicleTypeCount || static_cast<int>(direction) >= 4 ||
+        static_cast<int>(approach) >= 4 || static_cast<int>(movement) >= kMovementsPerApproach ||
+        movementBit != ::movementBit(approach, movement)) {
+        return false;
+    }
+    if (!isFlagByte(turned) || !isFlagByte(passedStopLine) || !isFlagByte(committed)) {
+        return false;
+    }
+    return std::isfinite(position.x) && std::isfinite(position.y) && std::isfinite(lastPosition.x) &&
+           std::isfinite(lastPosition.y) && std::isfinite(speed) && speed >= 0.f &&
+           std::isfinite(stoppedTime) && std::isfinite(turnAt);
+}
+
 
 
 
@@ -2,8 +2,9 @@
 #define VEHICLE_HPP
 
 #include <SFML/Graphics.hpp>
+#include <cstdint>
 
-enum class VehicleType {
+enum class VehicleType : std::uint8_t {
     Normal,
     Taxi,
     Ambulance,
@@ -14,29 +15,62 @@ enum class VehicleType {
     BigTruck
 };
 
-enum class Direction {
+constexpr int kVehicleTypeCount = static_cast<int>(VehicleType::BigTruck) + 1;
+
+enum class Direction : std::uint8_t {
     TopToBottom,
     BottomToTop,
     LeftToRight,
     RightToLeft
 };
 
+// Movement a vehicle makes through the intersection, relative to its approach.
+enum class Movement : std::uint8_t {
+    Left,
+    Straight,
+    Right
+};
+
+// A vehicle is plain simulation state: it owns no textures or sprites, so
+// headless runs never touch the graphics system and vehicles can be stored and
+// copied by value. Textures are shared per vehicle class and loaded on first render.
 class Vehicle {
 public:
-    Vehicle(const sf::Vector2f& startPos, VehicleType type, Direction dir);
+    Vehicle(const sf::Vector2f& startPos, VehicleType type, Direction dir,
+            Movement movement = Movement::Straight);
 
+    // Moves at the given speed for dt seconds and records it as the current speed.
     void update(float dt, float speed);
-    void render(sf::RenderWindow& window);
+    void render(sf::RenderWindow& window) const;
 
     VehicleType getType() const;
     Direction getDirection() const;
 
-    float getX() const;
-    float getY() const;
+    // Approach the vehicle arrived on; unlike getDirection() it does not change after a turn.
+    Direction getApproach() const { return approach; }
+    Movement getMovement() const { return movement; }
+    std::uint64_t getMovementBit() const { return movementBit; }
+
+    // Coordinate along the approach axis where a turning vehicle swings into its exit lane.
+    void setTurnPoint(float coordinate) { turnAt = coordinate; }
+    bool hasTurned() const { return turned; }
+
+    // Lane index within the current direction of travel.
+    int getLane() const { return lane; }
+    void setLane(int newLane) { lane = newLane; }
+    // Shifts sideways onto another lane whose centre lies at the given cross-axis coordinate.
+    void moveToLane(int newLane, float coordinate);
+
+    float getX() const { return position.x; }
+    float getY() const { return position.y; }
 
     // New methods for stop-line logic
     bool hasPassedStopLine() const;
     void setPassedStopLine(bool val);
+    // Set when the vehicle's movement lost its permission while the vehicle was
+    // too close to stop: it may still cross the stop line.
+    bool isCommitted() const { return committed; }
+    void setCommitted(bool val) { committed = val; }
 
     // New: Store the last position for displacement calculation.
     sf::Vector2f lastPosition;
@@ -46,17 +80,26 @@ public:
     float speed; // public or add a getter function
     float getSpeed() const { return speed; }
 
+    // Whether every field holds a value a live vehicle can have (enums in range,
+    // finite coordinates and speeds), e.g. for one read back from a checkpoint.
+    bool isWellFormed() const;
+
 private:
+    sf::Vector2f position;
+    std::uint64_t movementBit;
+    float turnAt;
+    int lane;
     VehicleType type;
     Direction direction;
-
-    sf::Sprite sprite;
-    sf::Texture texture;
-    bool textureLoaded;
-    sf::RectangleShape fallback;
+    Direction approach;
+    Movement movement;
+    bool turned;
 
     // Flag indicating the vehicle has crossed the intersection stop line
     bool passedStopLine;
+    bool committed;
+
+    void completeTurn();
 };
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef VEHICLECLASS_HPP
+#define VEHICLECLASS_HPP
+
+#include "Vehicle.hpp"
+
+// Physical parameters of one vehicle class. Distances are in pixels,
+// speeds in pixels per second and accelerations in pixels per second squared.
+struct VehicleParams {
+    float length;        // Bumper to bumper, along the direction of travel.
+    float desiredSpeed;  // Cruising speed on a free road.
+    float acceleration;  // Pulling away, e.g. discharging from a queue.
+    float deceleration;  // Comfortable braking used to plan stops.
+    float minGap;        // Standstill gap kept to the vehicle ahead.
+    float renderScale;   // Sprite scale when drawn.
+    bool priority;       // Requests signal preemption (emergency vehicles).
+    const char* texture;
+};
+
+// One row per VehicleType, in enum order. Heavy vehicles are longer, slower
+// and accelerate more gently, so they take up more road and discharge slower.
+constexpr VehicleParams kVehicleParams[] = {
+    // length speed  accel  decel  gap    scale  prio   texture
+    { 44.f, 120.f, 120.f, 240.f, 36.f, 0.30f, false, "C:/TrafficLightSimulation/assets/car.png" },          // Normal
+    { 44.f, 120.f, 120.f, 240.f, 36.f, 0.30f, false, "C:/TrafficLightSimulation/assets/taxi.png" },         // Taxi
+    { 50.f, 140.f, 140.f, 260.f, 36.f, 0.30f, true,  "C:/TrafficLightSimulation/assets/ambulance.png" },    // Ambulance
+    { 44.f, 130.f, 130.f, 250.f, 36.f, 0.30f, false, "C:/TrafficLightSimulation/assets/Audi.png" },         // Audi
+    { 58.f, 100.f,  70.f, 180.f, 40.f, 0.34f, false, "C:/TrafficLightSimulation/assets/mini_truck.png" },   // Truck
+    { 70.f,  95.f,  55.f, 160.f, 40.f, 0.38f, false, "C:/TrafficLightSimulation/assets/police.png" },       // Bus
+    { 44.f, 135.f, 140.f, 260.f, 36.f, 0.30f, false, "C:/TrafficLightSimulation/assets/black_viper.png" },  // BlackViper
+    { 84.f,  85.f,  45.f, 140.f, 44.f, 0.42f, false, "C:/TrafficLightSimulation/assets/truck.png" },        // BigTruck
+};
+
+static_assert(sizeof(kVehicleParams) / sizeof(kVehicleParams[0]) ==
+                  static_cast<int>(VehicleType::BigTruck) + 1,
+              "kVehicleParams needs one row per VehicleType");
+
+constexpr const VehicleParams& vehicleParams(VehicleType type) {
+    return kVehicleParams[static_cast<int>(type)];
+}
+
+#endif
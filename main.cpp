@@ -1,7 +1,23 @@
 #include <SFML/Graphics.hpp>
 #include "TrafficManager.hpp"
+#include "QTableLoader.hpp"
+#include "LinearPolicy.hpp"
+#include "MlpPolicy.hpp"
 #include <sstream>
 #include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+// Time warp: the simulation advances in fixed substeps, as many per frame as the
+// chosen speed asks for and the frame-time budget allows. 0 means "as fast as possible".
+static const float kSimStep = 1.f / 30.f;
+static const float kFrameBudget = 0.012f;  // Seconds of each ~16.7 ms frame spent simulating.
+static const int kWarpLevels[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 0 };
+static const int kWarpLevelCount = sizeof(kWarpLevels) / sizeof(kWarpLevels[0]);
+static const size_t kDefaultReplayCapacity = size_t(1) << 20;  // 80 MB ring file.
 
 // Helper function: checks if the mouse is over a given rectangle
 bool isMouseOverButton(const sf::RectangleShape& button, const sf::Vector2f& mousePos)
@@ -9,7 +25,77 @@ bool isMouseOverButton(const sf::RectangleShape& button, const sf::Vector2f& mou
     return button.getGlobalBounds().contains(mousePos);
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Command line: --demand <profile.csv|profile.bin> --lanes <1-3> --restore <checkpoint>
+    //               --policy <q_table.json|policy.qtp> --learn <snapshot.json|snapshot.qtp>
+    //               --watch (reload the policy file whenever it changes)
+    //               --qfunction <policy.tlp|policy.tnn> (linear or MLP policy)
+    //               --replay <experience.trb> (log every decision to a replay ring file)
+    std::string demandFile;
+    std::string learnFile;
+    bool watchPolicy = false;
+    std::string qFunctionFile;
+    std::string replayFile;
+    std::string restoreFile;
+    const std::string checkpointFile = "checkpoint.tmck";
+    SimConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--demand" && i + 1 < argc) {
+            demandFile = argv[++i];
+        } else if (arg == "--lanes" && i + 1 < argc) {
+            config.lanesPerApproach = std::atoi(argv[++i]);
+        } else if (arg == "--restore" && i + 1 < argc) {
+            restoreFile = argv[++i];
+        } else if (arg == "--policy" && i + 1 < argc) {
+            config.qTablePath = argv[++i];
+        } else if (arg == "--learn" && i + 1 < argc) {
+            learnFile = argv[++i];
+        } else if (arg == "--watch") {
+            watchPolicy = true;
+        } else if (arg == "--qfunction" && i + 1 < argc) {
+            qFunctionFile = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayFile = argv[++i];
+        }
+    }
+    if (!learnFile.empty() && watchPolicy) {
+        // Online learning replaces the table itself, so there is no file to watch.
+        std::cerr << "--learn and --watch cannot be combined" << std::endl;
+        return 1;
+    }
+    if (!qFunctionFile.empty()) {
+        auto linear = std::make_shared<LinearPolicy>();
+        auto mlp = std::make_shared<MlpPolicy>();
+        if (MlpPolicy::isMlpFile(qFunctionFile) && MlpPolicy::load(qFunctionFile, *mlp)) {
+            config.qFunction = mlp;
+        } else if (LinearPolicy::load(qFunctionFile, *linear)) {
+            config.qFunction = linear;
+        } else {
+            std::cerr << "Falling back to the Q-table" << std::endl;
+        }
+    }
+    if (!learnFile.empty()) {
+        // Keep learning online from the loaded policy, snapshotting it to learnFile.
+        config.qTable = std::make_shared<const DenseQTable>(QTableLoader::loadDenseQTable(config.qTablePath));
+        OnlineLearnerSettings learning;
+        learning.snapshotPath = learnFile;
+        config.learner = std::make_shared<OnlineLearner>(*config.qTable, learning);
+    } else if (watchPolicy) {
+        config.qTable = std::make_shared<const DenseQTable>(QTableLoader::loadDenseQTable(config.qTablePath));
+        config.policyWatcher = std::make_shared<PolicyWatcher>(config.qTablePath, config.qTable);
+        config.qTable = config.policyWatcher->policy();
+    }
+
+    if (!replayFile.empty()) {
+        auto replay = std::make_shared<ReplayBuffer>(replayFile, kDefaultReplayCapacity);
+        if (replay->isOpen()) {
+            std::cout << "Replay ring " << replayFile << ": " << replay->size() << " records, "
+                      << replay->appended() << " appended so far" << std::endl;
+            config.replay = replay;
+        }
+    }
+
     sf::RenderWindow window(sf::VideoMode(900, 600), "4-Way Intersection");
     window.setFramerateLimit(60);
 
@@ -31,7 +117,27 @@ int main() {
     verticalLaneLine.setPosition(450.f, 0.f);
 
     // Create the TrafficManager instance (make sure it's declared before using in the button callback)
-    TrafficManager manager;
+    TrafficManager manager(config);
+
+    // Thin separators between neighbouring lanes of the same direction.
+    std::vector<sf::RectangleShape> laneSeparators;
+    for (int d = 0; d < 4; ++d) {
+        Direction dir = static_cast<Direction>(d);
+        bool vertical = (dir == Direction::TopToBottom || dir == Direction::BottomToTop);
+        for (int l = 1; l < manager.getLanesPerApproach(); ++l) {
+            float mid = 0.5f * (manager.getLaneCenter(dir, l - 1) + manager.getLaneCenter(dir, l));
+            sf::RectangleShape line(vertical ? sf::Vector2f(1.f, 600.f) : sf::Vector2f(900.f, 1.f));
+            line.setFillColor(sf::Color(150, 150, 150));
+            line.setPosition(vertical ? mid : 0.f, vertical ? 0.f : mid);
+            laneSeparators.push_back(line);
+        }
+    }
+    if (!demandFile.empty() && !manager.loadDemandProfile(demandFile)) {
+        std::cerr << "Falling back to preset spawn intervals" << std::endl;
+    }
+    if (!restoreFile.empty() && !manager.loadCheckpoint(restoreFile)) {
+        std::cerr << "Starting from an empty intersection" << std::endl;
+    }
 
     // --- Button Setup ---
     // Create a rectangle shape for the button
@@ -47,24 +153,30 @@ int main() {
     }
 
     // Create a text label to display the spawn interval on the button
-    sf::Text buttonText("Spawn Interval: 1.0f", font, 18);
+    sf::Text buttonText("", font, 18);
     buttonText.setFillColor(sf::Color::White);
     // Position the text relative to the button
     buttonText.setPosition(button.getPosition().x + 15, button.getPosition().y + 15);
 
+    // The label always shows the manager's interval, e.g. after a checkpoint restores it.
+    auto showSpawnInterval = [&manager, &buttonText]() {
+        std::ostringstream label;
+        label << "Spawn Interval: " << std::fixed << std::setprecision(1) << manager.getSpawnInterval() << "f";
+        buttonText.setString(label.str());
+    };
+    showSpawnInterval();
+
     // the button click to cycle through spawn interval options.
-    auto updateSpawnInterval = [&manager, &buttonText]() {
+    auto updateSpawnInterval = [&manager, &showSpawnInterval]() {
         // Cycle through: if current is 1.0f, set to 3.0f; if 3.0f, set to 0.5f; otherwise, reset to 1.0f.
         if (manager.getSpawnInterval() == 1.0f) {
             manager.setSpawnInterval(3.0f);
-            buttonText.setString("Spawn Interval: 3.0f");
         } else if (manager.getSpawnInterval() == 3.0f) {
             manager.setSpawnInterval(0.5f);
-            buttonText.setString("Spawn Interval: 0.5f");
         } else {
             manager.setSpawnInterval(1.0f);
-            buttonText.setString("Spawn Interval: 1.0f");
         }
+        showSpawnInterval();
         std::cout << "[DEBUG] Updated spawn interval to: " << manager.getSpawnInterval() << "\n";
     };
 
@@ -72,6 +184,13 @@ int main() {
 
     sf::Clock clock;
 
+    // Time warp state: +/- (or PageUp/PageDown) step through kWarpLevels.
+    int warpLevel = 0;
+    float simBacklog = 0.f;       // Simulated seconds owed to the chosen speed.
+    double warpWindowSim = 0.0;   // Simulated and wall seconds over the last measurement window,
+    double warpWindowWall = 0.0;  // for the achieved speed-up shown on the HUD.
+    double achievedWarp = 1.0;
+
     // Load a font for HUD overlay (if needed)
     sf::Font hudFont;
     if (!hudFont.loadFromFile("C:/TrafficLightSimulation/assets/OpenSans-Regular.ttf")) {
@@ -89,14 +208,60 @@ int main() {
             // Check for mouse button press event
             if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
                 sf::Vector2f mousePos = window.mapPixelToCoords(sf::Mouse::getPosition(window));
-                if (isMouseOverButton(button, mousePos)) {
+                // The spawn interval button is inactive while a demand profile drives spawning.
+                if (!manager.hasDemandProfile() && isMouseOverButton(button, mousePos)) {
                     updateSpawnInterval();
                 }
             }
+
+            // F5 saves a checkpoint of the running simulation, F9 restores it.
+            if (event.type == sf::Event::KeyPressed) {
+                if (event.key.code == sf::Keyboard::F5 && manager.saveCheckpoint(checkpointFile)) {
+                    std::cout << "[DEBUG] Checkpoint saved to " << checkpointFile << "\n";
+                } else if (event.key.code == sf::Keyboard::F9 && manager.loadCheckpoint(checkpointFile)) {
+                    std::cout << "[DEBUG] Checkpoint restored from " << checkpointFile << "\n";
+                    showSpawnInterval();
+                }
+
+                int previousLevel = warpLevel;
+                if (event.key.code == sf::Keyboard::Add || event.key.code == sf::Keyboard::Equal ||
+                    event.key.code == sf::Keyboard::PageUp) {
+                    warpLevel = std::min(warpLevel + 1, kWarpLevelCount - 1);
+                } else if (event.key.code == sf::Keyboard::Subtract || event.key.code == sf::Keyboard::Hyphen ||
+                           event.key.code == sf::Keyboard::PageDown) {
+                    warpLevel = std::max(warpLevel - 1, 0);
+                }
+                if (warpLevel != previousLevel) {
+                    simBacklog = 0.f;
+                    // The per-decision debug log would throttle a warped run to
+                    // stdout's speed, so it is only printed in real time.
+                    manager.setVerbose(config.verbose && kWarpLevels[warpLevel] == 1);
+                }
+            }
+        }
+
+        // Owe the simulation frame time times the warp factor, then pay it back in
+        // fixed substeps until the frame budget runs out. Time that does not fit is
+        // dropped rather than carried over, so a slow frame never snowballs.
+        float frameTime = clock.restart().asSeconds();
+        int warp = kWarpLevels[warpLevel];
+        simBacklog += warp > 0 ? frameTime * warp : 0.f;
+        sf::Clock budgetClock;
+        double simulated = 0.0;
+        while ((warp == 0 || simBacklog >= kSimStep) && budgetClock.getElapsedTime().asSeconds() < kFrameBudget) {
+            manager.update(kSimStep);
+            simBacklog -= kSimStep;
+            simulated += kSimStep;
         }
+        simBacklog = warp > 0 ? std::min(simBacklog, kSimStep) : 0.f;
 
-        float dt = clock.restart().asSeconds();
-        manager.update(dt);
+        warpWindowSim += simulated;
+        warpWindowWall += frameTime;
+        if (warpWindowWall >= 0.5) {
+            achievedWarp = warpWindowSim / warpWindowWall;
+            warpWindowSim = 0.0;
+            warpWindowWall = 0.0;
+        }
 
         window.clear(sf::Color(100, 200, 200)); // Clear with background color
 
@@ -105,6 +270,8 @@ int main() {
         window.draw(verticalRoad);
         window.draw(horizontalLaneLine);
         window.draw(verticalLaneLine);
+        for (const auto& line : laneSeparators)
+            window.draw(line);
 
         // Render the simulation (lights, vehicles, etc.)
         manager.render(window);
@@ -112,6 +279,24 @@ int main() {
         // Draw HUD overlay (vehicle count, etc.)
         std::stringstream ss;
         ss << "Vehicles on road: " << manager.getVehicleCount();
+        ss << "\nSpeed: ";
+        if (kWarpLevels[warpLevel] > 0) ss << kWarpLevels[warpLevel] << "x";
+        else ss << "max";
+        ss << " (achieved " << std::fixed << std::setprecision(0) << achievedWarp << "x)";
+        const SimMetrics& metrics = manager.getMetrics();
+        if (metrics.preemptionSamples > 0) {
+            ss << "\nPreemptions: " << metrics.preemptions << " cut, " << metrics.priorityHolds << " held (mean latency "
+               << std::fixed << std::setprecision(1) << metrics.meanPreemptionLatency() << " s)";
+        }
+        if (config.policyWatcher && config.policyWatcher->getReloads() > 0) {
+            ss << "\nPolicy reloads: " << config.policyWatcher->getReloads();
+        }
+        if (manager.hasDemandProfile()) {
+            // Show the profile clock as hh:mm so replayed count data can be followed.
+            int minutes = static_cast<int>(manager.getSimTime() / 60.0);
+            ss << "\nProfile time: " << std::setw(2) << std::setfill('0') << (minutes / 60) % 24
+               << ":" << std::setw(2) << std::setfill('0') << minutes % 60;
+        }
         sf::Text hudText;
         hudText.setFont(hudFont);
         hudText.setString(ss.str());
@@ -121,8 +306,10 @@ int main() {
         window.draw(hudText);
 
         // Draw the button and its label on top
-        window.draw(button);
-        window.draw(buttonText);
+        if (!manager.hasDemandProfile()) {
+            window.draw(button);
+            window.draw(buttonText);
+        }
 
         window.display();
     }
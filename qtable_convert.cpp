@@ -0,0 +1,94 @@
+// Converts Q-tables between the JSON written by traffic_rl.py and the binary
+// policy format the simulation maps in place. The direction follows the input:
+// a binary policy file becomes JSON, anything else is read as JSON.
+//
+// --dtype int8|fp16 writes a quantized policy file instead (from JSON or from
+// another policy file) and reports how often its greedy action agrees with
+// the full-precision table; --dtype f64 writes a full-precision one.
+//
+// Usage: qtable_convert [--dtype f64|int8|fp16] <input> <output>
+//   qtable_convert q_table.json q_table.qtp
+//   qtable_convert q_table.qtp q_table.json
+//   qtable_convert --dtype int8 q_table.json q_table.q8.qtp
+
+#include "QTableLoader.hpp"
+#include "QuantizedQTable.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static bool writeQuantized(const DenseQTable& table, PolicyDType dtype, const std::string& output) {
+    QuantizedQTable quantized = QuantizedQTable::quantize(table, dtype);
+    QuantizationReport report = quantized.compare(table);
+    std::printf("%s: scale %g, offset %g, %zu bytes (%zu as f64)\n", QuantizedQTable::dtypeName(dtype),
+                quantized.scale(), quantized.offset(), quantized.byteCount(), table.valueCount() * sizeof(double));
+    std::printf("Greedy-action agreement: %.3f%% of %zu states (%zu differ, %zu of them near ties); max value error %g\n",
+                100.0 * report.agreement(), report.states, report.states - report.agreements, report.nearTies,
+                report.maxError);
+    if (!QTableLoader::savePolicyFile(quantized, output)) {
+        return false;
+    }
+    std::cout << "Wrote " << table.nsStates() << " x " << table.ewStates() << " quantized states to " << output
+              << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bool hasDType = false;
+    PolicyDType dtype = PolicyDType::Float64;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dtype" && i + 1 < argc) {
+            if (!QuantizedQTable::parseDType(argv[++i], dtype)) {
+                std::cerr << "Unknown dtype: " << argv[i] << " (expected f64, int8 or fp16)" << std::endl;
+                return 1;
+            }
+            hasDType = true;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        std::cerr << "Usage: qtable_convert [--dtype f64|int8|fp16] <input> <output>" << std::endl;
+        return 1;
+    }
+    std::string input = paths[0];
+    std::string output = paths[1];
+
+    DenseQTable table;
+    if (QTableLoader::isPolicyFile(input)) {
+        // Quantized files are decoded here, so any policy file converts to any other.
+        if (!QTableLoader::loadPolicyFile(input, table)) {
+            return 1;
+        }
+        if (!hasDType) {
+            QTable keyed = table.toQTable();
+            if (!QTableLoader::saveQTable(keyed, output)) {
+                return 1;
+            }
+            std::cout << "Wrote " << keyed.size() << " states to " << output << std::endl;
+            return 0;
+        }
+    } else {
+        QTableLoadStats stats;
+        table = QTableLoader::loadDenseQTableJson(input, &stats);
+        if (stats.states == 0) {
+            std::cerr << "No states read from " << input << std::endl;
+            return 1;
+        }
+        std::cout << "Parsed " << stats.bytes << " bytes of JSON in " << stats.seconds * 1e3 << " ms ("
+                  << stats.megabytesPerSecond() << " MB/s)" << std::endl;
+    }
+
+    if (dtype != PolicyDType::Float64) {
+        return writeQuantized(table, dtype, output) ? 0 : 1;
+    }
+    if (!QTableLoader::savePolicyFile(table, output)) {
+        return 1;
+    }
+    std::cout << "Wrote " << table.nsStates() << " x " << table.ewStates() << " dense states to " << output
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Throughput benchmark for BatchEnv: steps batches of independent simulations
+// with random actions and reports decisions/sec for each batch size.
+//
+// Usage: traffic_batch [--sizes 1,8,64,256] [--steps 200] [--threads 1]
+//                      [--spawn-min 0.4] [--spawn-max 3] [--dt 0.1] [--seed 1]
+
+#include "BatchEnv.hpp"
+#include "SimRng.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::vector<int> parseSizes(const std::string& text) {
+    std::vector<int> sizes;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) sizes.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    return sizes;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> sizes = { 1, 8, 64, 256 };
+    int steps = 200;
+    std::uint64_t seed = 1;
+    BatchEnvConfig config;
+    config.spawnMin = 0.4f;
+    config.spawnMax = 3.f;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) sizes = parseSizes(argv[++i]);
+        else if (arg == "--steps" && i + 1 < argc) steps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) config.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--spawn-min" && i + 1 < argc) config.spawnMin = std::atof(argv[++i]);
+        else if (arg == "--spawn-max" && i + 1 < argc) config.spawnMax = std::atof(argv[++i]);
+        else if (arg == "--dt" && i + 1 < argc) config.dt = std::atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::printf("%8s %12s %14s %12s %8s\n", "batch", "decisions", "decisions/s", "mean reward", "episodes");
+    for (int size : sizes) {
+        BatchEnv env(size, config);
+        std::vector<int> actions(size), queueNS(size), queueEW(size);
+        std::vector<double> rewards(size);
+        std::vector<unsigned char> done(size);
+        SimRng rng(seed);
+
+        auto start = std::chrono::steady_clock::now();
+        env.reset(seed, queueNS.data(), queueEW.data());
+        double rewardSum = 0.0;
+        long long episodes = 0;
+        for (int s = 0; s < steps; ++s) {
+            for (int& a : actions) a = rng.nextInt(kQActions);
+            env.step(actions.data(), queueNS.data(), queueEW.data(), rewards.data(), done.data());
+            for (int i = 0; i < size; ++i) {
+                rewardSum += rewards[i];
+                episodes += done[i];
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%8d %12lld %14.0f %12.3f %8lld\n", size, env.getDecisions(), env.getDecisions() / seconds,
+                    rewardSum / env.getDecisions(), episodes);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+// Per-decision cost of the policy backends: the dense Q-table lookup (full
+// precision, int8 and fp16, in a small table and in one of --large-states
+// squared states, far beyond the caches), the
+// linear function-approximation policy at increasing polynomial degree and
+// MLP Q-networks of increasing width, each timed over the same random
+// observations. The MLPs are also timed evaluating --batch decisions at once,
+// as a corridor controller does (see CorridorController.hpp).
+//
+// Usage: traffic_policy_bench [--decisions 1000000] [--max-degree 6] [--batch 200]
+//                             [--large-states 1024] [--seed 1]
+
+#include "DenseQTable.hpp"
+#include "QuantizedQTable.hpp"
+#include "LinearPolicy.hpp"
+#include "MlpPolicy.hpp"
+#include "SimdKernels.hpp"
+#include "SimRng.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Times fn(i) over count decisions and returns nanoseconds per decision.
+template <typename Fn>
+static double timePerDecision(int count, Fn fn, long long& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        checksum += fn(i);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+int main(int argc, char* argv[]) {
+    int decisions = 1000000;
+    int maxDegree = kMaxLinearDegree;
+    int batch = 200;
+    int largeStates = 1024;
+    std::uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--decisions" && i + 1 < argc) decisions = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--max-degree" && i + 1 < argc) maxDegree = std::clamp(std::atoi(argv[++i]), 1, kMaxLinearDegree);
+        else if (arg == "--batch" && i + 1 < argc) batch = std::clamp(std::atoi(argv[++i]), 1, 4096);
+        else if (arg == "--large-states" && i + 1 < argc) largeStates = std::clamp(std::atoi(argv[++i]), 1, 8192);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // A pool of observations larger than L1, revisited in order.
+    const int poolSize = 4096;
+    SimRng rng(seed);
+    std::vector<float> observations(static_cast<size_t>(poolSize) * kObservationSize);
+    std::vector<std::pair<int, int>> states(poolSize);
+    for (int i = 0; i < poolSize; ++i) {
+        float* o = &observations[static_cast<size_t>(i) * kObservationSize];
+        for (int k = 0; k < kObservationSize; ++k) o[k] = rng.nextFloat();
+        states[i] = { static_cast<int>(o[ObsQueueNS] * kObservationQueueScale),
+                      static_cast<int>(o[ObsQueueEW] * kObservationQueueScale) };
+    }
+
+    std::printf("Kernels: %s\n", simd::kernelName());
+    std::printf("%-20s %10s %14s\n", "backend", "size", "ns/decision");
+    long long checksum = 0;
+
+    // Small tables are looked up at the pool's states, the large ones at a
+    // pseudo-random state per decision, so nearly every lookup misses the caches.
+    double ns = 0.0;
+    for (int side : { 65, largeStates }) {
+        DenseQTable table(side, side);
+        for (int n = 0; n < side; ++n)
+            for (int e = 0; e < side; ++e)
+                for (int a = 0; a < kQActions; ++a) table.mutableValues(n, e)[a] = rng.nextFloat();
+        QuantizedQTable int8Table = QuantizedQTable::quantize(table, PolicyDType::Int8);
+        QuantizedQTable halfTable = QuantizedQTable::quantize(table, PolicyDType::Float16);
+        auto state = [&](int i) {
+            if (side == 65) return states[i & (poolSize - 1)];
+            std::uint64_t h = static_cast<std::uint64_t>(i) * 0x9E3779B97F4A7C15ull;
+            return std::pair<int, int>(static_cast<int>((h >> 40) % side), static_cast<int>((h >> 20) % side));
+        };
+        const char* suffix = side == 65 ? "" : " large";
+        ns = timePerDecision(decisions, [&](int i) {
+            std::pair<int, int> s = state(i);
+            return DenseQTable::argmax(table.values(s.first, s.second));
+        }, checksum);
+        std::printf("%-20s %10d %14.1f\n", (std::string("q-table f64") + suffix).c_str(), 2, ns);
+        for (const QuantizedQTable* quantized : { &int8Table, &halfTable }) {
+            ns = timePerDecision(decisions, [&](int i) {
+                std::pair<int, int> s = state(i);
+                return quantized->argmax(s.first, s.second);
+            }, checksum);
+            std::string name = std::string("q-table ") + QuantizedQTable::dtypeName(quantized->dtype()) + suffix;
+            std::printf("%-20s %10d %14.1f\n", name.c_str(), 2, ns);
+        }
+    }
+
+    for (int degree = 1; degree <= maxDegree; ++degree) {
+        LinearPolicy policy(degree);
+        // Random weights, so argmax is not trivially the first action.
+        std::vector<float> phi(policy.getFeatureCount());
+        for (int a = 0; a < kQActions; ++a) {
+            for (float& f : phi) f = rng.nextFloat() - 0.5f;
+            policy.update(phi.data(), a, 1.f);
+        }
+        ns = timePerDecision(decisions, [&](int i) {
+            return policy.greedy(&observations[static_cast<size_t>(i & (poolSize - 1)) * kObservationSize]);
+        }, checksum);
+        char name[32];
+        std::snprintf(name, sizeof(name), "linear deg %d", degree);
+        std::printf("%-20s %10d %14.1f\n", name, policy.getFeatureCount(), ns);
+    }
+
+    const std::vector<std::vector<int>> networks = { { 32, 32 }, { 64, 64 }, { 128, 128 }, { 128, 128, 128 } };
+    for (const std::vector<int>& hidden : networks) {
+        MlpPolicy policy(hidden, seed);
+        ns = timePerDecision(decisions, [&](int i) {
+            return policy.greedy(&observations[static_cast<size_t>(i & (poolSize - 1)) * kObservationSize]);
+        }, checksum);
+        std::string name = "mlp";
+        for (size_t l = 0; l < hidden.size(); ++l) {
+            name += (l == 0 ? " " : "x") + std::to_string(hidden[l]);
+        }
+        std::printf("%-20s %10zu %14.1f\n", name.c_str(), policy.getParameterCount(), ns);
+
+        // The same decisions in batches; each call covers `batch` of them.
+        std::vector<float> q(static_cast<size_t>(batch) * kQActions);
+        int calls = std::max(1, decisions / batch);
+        ns = timePerDecision(calls, [&](int i) {
+            int first = (i * batch) % (poolSize - batch + 1);
+            policy.evaluateBatch(&observations[static_cast<size_t>(first) * kObservationSize], batch, q.data());
+            return static_cast<long long>(q[0] > q[1]);
+        }, checksum) / batch;
+        std::printf("%-20s %10zu %14.1f\n", (name + " b" + std::to_string(batch)).c_str(),
+                    policy.getParameterCount(), ns);
+    }
+    std::printf("(checksum %lld)\n", checksum);
+    return 0;
+}
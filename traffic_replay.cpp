@@ -0,0 +1,200 @@
+// Collects decisions into a persistent replay ring file and samples them
+// concurrently. The main thread runs headless episodes (the simulation's own
+// inline decisions, from --policy, each logged by the simulation into the
+// ring) while --threads trainer threads draw minibatches, uniformly or
+// --prioritized, and the append and sample rates are reported. The ring file
+// outlives the run: a later run resumes appending to it, and --episodes 0
+// samples only what earlier runs logged.
+//
+// --fit out.tnn then trains an MLP Q-network offline from the ring (see
+// MlpPolicy.hpp), --fit-steps minibatches against a target network; under
+// --prioritized each sampled record's priority follows its latest TD error.
+//
+// Usage: traffic_replay [--file experience.trb] [--capacity 1048576]
+//                       [--episodes 50] [--episode-seconds 600] [--policy q_table.json]
+//                       [--spawn-min 0.4] [--spawn-max 3] [--dt 0.1] [--seed 1]
+//                       [--threads 2] [--prioritized] [--batch 32]
+//                       [--fit policy.tnn] [--fit-steps 20000] [--mlp 64,64] [--lr 0.001] [--gamma 0.95]
+
+#include "ReplayBuffer.hpp"
+#include "TrafficManager.hpp"
+#include "QTableLoader.hpp"
+#include "MlpPolicy.hpp"
+#include "SimRng.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const int kTargetSync = 1000;
+
+static std::vector<int> parseCounts(const std::string& text) {
+    std::vector<int> counts;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) counts.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    return counts;
+}
+
+static int sample(ReplayBuffer& replay, bool prioritized, SimRng& rng, int count, ReplayRecord* out,
+                  std::uint64_t* indices) {
+    return prioritized ? replay.samplePrioritized(rng, count, out, indices)
+                       : replay.sampleUniform(rng, count, out, indices);
+}
+
+int main(int argc, char* argv[]) {
+    std::string file = "experience.trb";
+    size_t capacity = size_t(1) << 20;
+    int episodes = 50;
+    float episodeSeconds = 600.f;
+    float spawnMin = 0.4f;
+    float spawnMax = 3.f;
+    float dt = 0.1f;
+    std::uint64_t seed = 1;
+    int threads = 2;
+    bool prioritized = false;
+    int batch = 32;
+    std::string fitFile;
+    int fitSteps = 20000;
+    std::vector<int> mlpHidden = { 64, 64 };
+    float learningRate = 0.001f;
+    double gamma = 0.95;
+    SimConfig base;
+    base.headless = true;
+    base.verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--file" && i + 1 < argc) file = argv[++i];
+        else if (arg == "--capacity" && i + 1 < argc) capacity = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--episodes" && i + 1 < argc) episodes = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--episode-seconds" && i + 1 < argc) episodeSeconds = std::atof(argv[++i]);
+        else if (arg == "--policy" && i + 1 < argc) base.qTablePath = argv[++i];
+        else if (arg == "--spawn-min" && i + 1 < argc) spawnMin = std::atof(argv[++i]);
+        else if (arg == "--spawn-max" && i + 1 < argc) spawnMax = std::atof(argv[++i]);
+        else if (arg == "--dt" && i + 1 < argc) dt = std::atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--prioritized") prioritized = true;
+        else if (arg == "--batch" && i + 1 < argc) batch = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--fit" && i + 1 < argc) fitFile = argv[++i];
+        else if (arg == "--fit-steps" && i + 1 < argc) fitSteps = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--mlp" && i + 1 < argc) mlpHidden = parseCounts(argv[++i]);
+        else if (arg == "--lr" && i + 1 < argc) learningRate = std::atof(argv[++i]);
+        else if (arg == "--gamma" && i + 1 < argc) gamma = std::atof(argv[++i]);
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    auto replay = std::make_shared<ReplayBuffer>(file, capacity);
+    if (!replay->isOpen()) {
+        return 1;
+    }
+    std::uint64_t resumedAt = replay->appended();
+    std::printf("Replay ring %s: capacity %zu, %zu records, %llu appended so far\n", file.c_str(),
+                replay->capacity(), replay->size(), static_cast<unsigned long long>(resumedAt));
+
+    // Collection: the simulation appends as it decides; trainers sample meanwhile.
+    base.qTable = std::make_shared<const DenseQTable>(QTableLoader::loadDenseQTable(base.qTablePath));
+    base.replay = replay;
+    std::atomic<bool> collecting(episodes > 0);
+    std::vector<long long> sampled(threads, 0);
+    std::vector<std::thread> trainers;
+    for (int t = 0; t < threads && episodes > 0; ++t) {
+        trainers.emplace_back([&, t] {
+            SimRng rng(seed * 0x9E3779B97F4A7C15ull + 101 + t);
+            std::vector<ReplayRecord> records(batch);
+            std::vector<std::uint64_t> indices(batch);
+            while (collecting.load(std::memory_order_relaxed)) {
+                int got = sample(*replay, prioritized, rng, batch, records.data(), indices.data());
+                sampled[t] += got;
+                if (got == 0) std::this_thread::yield();
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    SimRng rng(seed);
+    for (int episode = 0; episode < episodes; ++episode) {
+        SimConfig config = base;
+        config.seed = seed + static_cast<std::uint64_t>(episode) + 1;
+        config.spawnInterval = spawnMin + (spawnMax - spawnMin) * rng.nextFloat();
+        TrafficManager sim(config);
+        for (float t = 0.f; t < episodeSeconds; t += dt) {
+            sim.update(dt);
+        }
+    }
+    collecting = false;
+    for (std::thread& trainer : trainers) {
+        trainer.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    replay->flush();
+    if (episodes > 0) {
+        long long totalSampled = 0;
+        for (long long count : sampled) totalSampled += count;
+        std::uint64_t appended = replay->appended() - resumedAt;
+        std::printf("Collected %llu decisions in %.2f s (%.0f/s) while %d %s trainers sampled %lld (%.0f/s)\n",
+                    static_cast<unsigned long long>(appended), seconds, appended / seconds, threads,
+                    prioritized ? "prioritized" : "uniform", totalSampled, totalSampled / seconds);
+    }
+
+    if (fitFile.empty()) {
+        return 0;
+    }
+    if (replay->size() < static_cast<size_t>(batch)) {
+        std::cerr << "Not enough records to fit: " << replay->size() << std::endl;
+        return 1;
+    }
+    MlpPolicy policy(mlpHidden, seed);
+    MlpPolicy target = policy;
+    std::vector<ReplayRecord> records(batch);
+    std::vector<std::uint64_t> indices(batch);
+    std::vector<float> observations(static_cast<size_t>(batch) * kObservationSize);
+    std::vector<int> actions(batch);
+    std::vector<float> targets(batch);
+    double lossSum = 0.0;
+    start = std::chrono::steady_clock::now();
+    for (int step = 1; step <= fitSteps; ++step) {
+        int got = sample(*replay, prioritized, rng, batch, records.data(), indices.data());
+        for (int b = 0; b < got; ++b) {
+            const ReplayRecord& r = records[b];
+            float q[kQActions];
+            target.evaluate(r.next, q);
+            std::copy(r.observation, r.observation + kObservationSize, &observations[static_cast<size_t>(b) * kObservationSize]);
+            actions[b] = r.action;
+            targets[b] = r.reward + (r.done ? 0.f : static_cast<float>(gamma) * std::max({ q[0], q[1], q[2] }));
+            if (prioritized) {
+                policy.evaluate(r.observation, q);
+                replay->updatePriority(indices[b], targets[b] - q[r.action]);
+            }
+        }
+        lossSum += policy.train(observations.data(), actions.data(), targets.data(), got, learningRate);
+        if (step % kTargetSync == 0) {
+            target = policy;
+        }
+        if (step % 5000 == 0) {
+            std::printf("Step %d: loss %.4f\n", step, lossSum / 5000);
+            std::fflush(stdout);
+            lossSum = 0.0;
+        }
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Fitted %d minibatches in %.1f s\n", fitSteps, seconds);
+    replay->flush();
+    if (!policy.save(fitFile)) {
+        return 1;
+    }
+    std::cout << "MLP policy written to " << fitFile << std::endl;
+    return 0;
+}
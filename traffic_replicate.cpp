@@ -0,0 +1,173 @@
+// Monte Carlo replication runner for TrafficManager.
+//
+// Runs independent headless replications of one scenario, each with its own
+// seed, spread over every core. Per-replication metrics (mean delay, throughput,
+// max queue) are streamed to stdout as they finish and folded into running
+// means and 95% confidence intervals. Once at least --min replications are in
+// and the delay interval is narrower than --ci-width, no new replications start.
+//
+// Usage: traffic_replicate [--replications 100] [--min 10] [--ci-width 0.5]
+//                          [--seconds 3600] [--dt 0.1] [--lanes 1] [--spawn 1.0]
+//                          [--demand profile.csv] [--seed 1] [--threads N]
+
+#include "TrafficManager.hpp"
+#include "QTableLoader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ReplicationResult {
+    double meanDelay;   // Seconds per served vehicle.
+    double throughput;  // Served vehicles per hour.
+    double maxQueue;    // Vehicles.
+};
+
+// Welford running mean and variance of one metric.
+struct RunningStat {
+    int n = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double x) {
+        ++n;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+    double variance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+
+    // Half-width of the 95% confidence interval of the mean (Student t).
+    double halfWidth() const {
+        if (n < 2) {
+            return INFINITY;
+        }
+        // Cornish-Fisher expansion of the t quantile around z = 1.96.
+        const double z = 1.959964;
+        double dof = n - 1;
+        double t = z + (z * z * z + z) / (4.0 * dof) +
+                   (5.0 * std::pow(z, 5) + 16.0 * z * z * z + 3.0 * z) / (96.0 * dof * dof);
+        return t * std::sqrt(variance() / n);
+    }
+};
+
+// Returns false if the demand profile could not be loaded.
+static bool runReplication(const SimConfig& config, const std::string& demandFile, float seconds, float dt,
+                           ReplicationResult& result) {
+    TrafficManager manager(config);
+    if (!demandFile.empty() && !manager.loadDemandProfile(demandFile)) {
+        return false;
+    }
+    int ticks = std::max(1, static_cast<int>(seconds / dt));
+    for (int t = 0; t < ticks; ++t) {
+        manager.update(dt);
+    }
+    const SimMetrics& m = manager.getMetrics();
+    result = { m.meanDelay(), m.vehiclesServed * 3600.0 / manager.getSimTime(), static_cast<double>(m.maxQueue) };
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int replications = 100;
+    int minReplications = 10;
+    double ciWidth = 0.5;
+    float seconds = 3600.f;
+    float dt = 0.1f;
+    SimConfig base;
+    base.headless = true;
+    base.verbose = false;
+    std::string demandFile;
+    std::uint64_t baseSeed = 1;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--replications" && i + 1 < argc) replications = std::atoi(argv[++i]);
+        else if (arg == "--min" && i + 1 < argc) minReplications = std::atoi(argv[++i]);
+        else if (arg == "--ci-width" && i + 1 < argc) ciWidth = std::atof(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--dt" && i + 1 < argc) dt = std::atof(argv[++i]);
+        else if (arg == "--lanes" && i + 1 < argc) base.lanesPerApproach = std::atoi(argv[++i]);
+        else if (arg == "--spawn" && i + 1 < argc) base.spawnInterval = std::atof(argv[++i]);
+        else if (arg == "--demand" && i + 1 < argc) demandFile = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc) baseSeed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+    threads = std::clamp(threads, 1, std::max(1, replications));
+    minReplications = std::clamp(minReplications, 2, std::max(2, replications));
+
+    // Every replication streams the profile itself; check it opens before any start.
+    if (!demandFile.empty() && !DemandProfile().open(demandFile)) {
+        return 1;
+    }
+
+    // One Q-table shared by every replication.
+    base.qTable = std::make_shared<const DenseQTable>(QTableLoader::loadDenseQTable(base.qTablePath));
+
+    std::atomic<int> nextReplication{0};
+    std::atomic<bool> done{false};
+    std::atomic<bool> failed{false};
+    std::mutex aggregateMutex;
+    RunningStat delay, throughput, maxQueue;
+
+    std::printf("%6s %12s %12s %12s %12s\n", "rep", "seed", "delay s", "veh/h", "max queue");
+    auto worker = [&]() {
+        while (!done.load()) {
+            int r = nextReplication.fetch_add(1);
+            if (r >= replications) {
+                break;
+            }
+            SimConfig config = base;
+            config.seed = baseSeed + static_cast<std::uint64_t>(r);
+            ReplicationResult result;
+            if (!runReplication(config, demandFile, seconds, dt, result)) {
+                failed.store(true);
+                done.store(true);
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(aggregateMutex);
+            delay.add(result.meanDelay);
+            throughput.add(result.throughput);
+            maxQueue.add(result.maxQueue);
+            std::printf("%6d %12llu %12.3f %12.1f %12.0f\n", r, static_cast<unsigned long long>(config.seed),
+                        result.meanDelay, result.throughput, result.maxQueue);
+            std::fflush(stdout);
+            if (delay.n >= minReplications && 2.0 * delay.halfWidth() <= ciWidth) {
+                done.store(true);
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    if (failed.load()) {
+        std::cerr << "A replication could not load the demand profile " << demandFile << std::endl;
+        return 1;
+    }
+    std::printf("\n%d replications%s\n", delay.n,
+                delay.n < replications ? " (stopped early: delay CI width target met)" : "");
+    std::printf("%-12s %12s %12s %12s\n", "metric", "mean", "95% +/-", "std dev");
+    auto row = [](const char* name, const RunningStat& s) {
+        std::printf("%-12s %12.3f %12.3f %12.3f\n", name, s.mean, s.halfWidth(), std::sqrt(s.variance()));
+    };
+    row("delay s", delay);
+    row("veh/h", throughput);
+    row("max queue", maxQueue);
+    return 0;
+}
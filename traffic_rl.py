@@ -2,15 +2,17 @@ import numpy as np
 import random
 import json
 import os
+import sys
+import ctypes
 
 class TrafficEnv:
     """
     A simple traffic environment.
     State: (queueNS, queueEW) - number of vehicles waiting on North-South and East-West.
-    Action:
-      0: Decrease green time by 1 second.
-      1: No change.
-      2: Increase green time by 1 second.
+    Action (same meaning as in TrafficManager::applyRLDecision):
+      0: No change.
+      1: Increase green time by 1 second.
+      2: Decrease green time by 1 second.
     Reward:
       Negative total queue length (we want to minimize congestion).
     """
@@ -25,8 +27,8 @@ class TrafficEnv:
         return (self.queueNS, self.queueEW)
 
     def step(self, action):
-        # Action: 0 -> decrease, 1 -> no change, 2 -> increase green time
-        adjustment = action - 1  # Maps (0,1,2) -> (-1,0,+1)
+        # Action: 0 -> no change, 1 -> increase, 2 -> decrease green time
+        adjustment = (0, 1, -1)[action]
         self.green_time = max(3, min(10, self.base_green + adjustment))  # Ensures reasonable green times
 
         # Simulate effect: NS green reduces NS queue; EW queue increases slightly
@@ -38,6 +40,52 @@ class TrafficEnv:
         done = False  # Continuous environment
         return next_state, reward, done, {}
 
+class NativeTrafficEnv:
+    """
+    The real C++ simulation through libtrafficsim (see trafficsim.h), with the
+    same reset/step interface as TrafficEnv. A step runs the simulation to its
+    next phase-end decision; the reward is the simulation's own shaped reward.
+    """
+    API_VERSION = 2  # TRAFFICSIM_API_VERSION in trafficsim.h
+
+    def __init__(self, lib_path=None, lanes=1, spawn_interval=1.0, seed=1):
+        if lib_path is None:
+            lib_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bin",
+                                    "trafficsim.dll" if os.name == "nt" else "libtrafficsim.so")
+        lib = ctypes.CDLL(lib_path)
+        version = lib.ts_api_version()
+        if version != self.API_VERSION:
+            raise RuntimeError("libtrafficsim API version %d, expected %d" % (version, self.API_VERSION))
+        int32_p = ctypes.POINTER(ctypes.c_int32)
+        lib.ts_create.restype = ctypes.c_void_p
+        lib.ts_create.argtypes = [ctypes.c_int, ctypes.c_double]
+        lib.ts_destroy.argtypes = [ctypes.c_void_p]
+        lib.ts_seed.argtypes = [ctypes.c_void_p, ctypes.c_uint64]
+        lib.ts_reset.argtypes = [ctypes.c_void_p, int32_p]
+        lib.ts_step.argtypes = [ctypes.c_void_p, ctypes.c_int, int32_p, ctypes.POINTER(ctypes.c_double)]
+        self.lib = lib
+        self.env = lib.ts_create(lanes, spawn_interval)
+        if not self.env:
+            raise RuntimeError("ts_create failed")
+        lib.ts_seed(self.env, seed)
+        self.state = (ctypes.c_int32 * 2)()
+        self.reward = ctypes.c_double()
+
+    def __del__(self):
+        if getattr(self, "env", None):
+            self.lib.ts_destroy(self.env)
+
+    def reset(self):
+        if self.lib.ts_reset(self.env, self.state) != 0:
+            raise RuntimeError("ts_reset failed: no decision within the wait limit")
+        return (self.state[0], self.state[1])
+
+    def step(self, action):
+        done = self.lib.ts_step(self.env, int(action), self.state, ctypes.byref(self.reward))
+        if done < 0:
+            raise RuntimeError("ts_step failed")
+        return (self.state[0], self.state[1]), self.reward.value, bool(done), {}
+
 class QLearningAgent:
     def __init__(self, action_space_size, alpha=0.015, gamma=0.97, epsilon=0.1):
         self.alpha = alpha      # Learning rate (Lowered for stability)
@@ -84,7 +132,8 @@ def load_q_table(filename="q_table.json"):
     return {}
 
 if __name__ == '__main__':
-    env = TrafficEnv()
+    # --native trains against the C++ simulation (bin/libtrafficsim) instead of the toy model.
+    env = NativeTrafficEnv() if "--native" in sys.argv else TrafficEnv()
     agent = QLearningAgent(action_space_size=3, alpha=0.015, gamma=0.97, epsilon=0.1)
     
     # Load existing Q-table if available
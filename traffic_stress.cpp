@@ -0,0 +1,142 @@
+// Headless stress test for TrafficManager.
+//
+// Builds synthetic networks of independent intersections whose approaches are
+// stretched until the requested number of vehicles fits (1k, 10k and 100k by
+// default), then steps every intersection with a fixed dt and reports tick time,
+// memory per vehicle and vehicles updated per second. It fails if any vehicle
+// crossed its stop line without permission (or a dilemma-zone commitment).
+//
+// Usage: traffic_stress [--sizes 1000,10000,100000] [--seconds 10] [--dt 0.0333]
+//                       [--lanes 3] [--per-intersection 1000]
+
+#include "TrafficManager.hpp"
+#include "QTableLoader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Resident set size in kilobytes (Linux); 0 where /proc is unavailable.
+static long residentKb() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (statm >> pages >> resident && pageSize > 0) {
+        return resident * (pageSize / 1024);
+    }
+#endif
+    return 0;
+}
+
+static std::vector<int> parseSizes(const std::string& text) {
+    std::vector<int> sizes;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) sizes.push_back(std::atoi(item.c_str()));
+    }
+    return sizes;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> sizes = {1000, 10000, 100000};
+    float seconds = 10.f;
+    float dt = 1.f / 30.f;
+    int lanes = 3;
+    int perIntersection = 1000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) sizes = parseSizes(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--dt" && i + 1 < argc) dt = std::atof(argv[++i]);
+        else if (arg == "--lanes" && i + 1 < argc) lanes = std::atoi(argv[++i]);
+        else if (arg == "--per-intersection" && i + 1 < argc) perIntersection = std::atoi(argv[++i]);
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+    lanes = std::clamp(lanes, 1, TrafficManager::kMaxLanes);
+
+    // One Q-table shared by every intersection.
+    auto table = std::make_shared<const DenseQTable>(QTableLoader::loadDenseQTable("q_table.json"));
+
+    std::printf("%10s %8s %10s %10s %10s %10s %14s %10s\n", "target", "signals", "vehicles",
+                "tick ms", "p99 ms", "max ms", "veh-upd/s", "B/vehicle");
+    long long violations = 0;
+
+    for (int target : sizes) {
+        int intersections = std::max(1, target / perIntersection);
+        int perSignal = target / intersections;
+        // Approaches long enough to hold every vehicle queued at ~90 px spacing.
+        int perLane = perSignal / (4 * lanes) + 1;
+        float margin = std::max(50.f, perLane * 90.f);
+
+        long rssBefore = residentKb();
+        std::vector<std::unique_ptr<TrafficManager>> network;
+        network.reserve(intersections);
+        for (int i = 0; i < intersections; ++i) {
+            SimConfig config;
+            config.lanesPerApproach = lanes;
+            config.headless = true;
+            config.verbose = false;
+            config.seed = static_cast<std::uint64_t>(i) + 1;
+            config.roadMargin = margin;
+            config.qTable = table;
+            config.spawnInterval = 0.5f;
+            auto manager = std::make_unique<TrafficManager>(config);
+            manager->populate(perSignal);
+            network.push_back(std::move(manager));
+        }
+        long rssAfter = residentKb();
+
+        size_t vehicles = 0;
+        for (auto& m : network) vehicles += m->getVehicleCount();
+
+        int ticks = std::max(1, static_cast<int>(seconds / dt));
+        std::vector<double> tickMs;
+        tickMs.reserve(ticks);
+        double vehicleUpdates = 0.0;
+        for (int t = 0; t < ticks; ++t) {
+            size_t inFlight = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (auto& m : network) {
+                inFlight += m->getVehicleCount();
+                m->update(dt);
+            }
+            auto end = std::chrono::steady_clock::now();
+            tickMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            vehicleUpdates += static_cast<double>(inFlight);
+        }
+
+        double total = 0.0;
+        for (double ms : tickMs) total += ms;
+        std::vector<double> sorted = tickMs;
+        std::sort(sorted.begin(), sorted.end());
+        double p99 = sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99))];
+        double bytesPerVehicle = vehicles > 0 && rssAfter > rssBefore
+            ? (rssAfter - rssBefore) * 1024.0 / vehicles
+            : static_cast<double>(sizeof(Vehicle));
+
+        std::printf("%10d %8d %10zu %10.3f %10.3f %10.3f %14.0f %10.1f\n", target, intersections, vehicles,
+                    total / ticks, p99, sorted.back(), vehicleUpdates / (total / 1000.0), bytesPerVehicle);
+        for (auto& m : network) violations += m->getMetrics().stopLineViolations;
+    }
+    std::printf("sizeof(Vehicle) = %zu bytes\n", sizeof(Vehicle));
+    if (violations > 0) {
+        std::cerr << violations << " vehicles crossed a stop line without permission" << std::endl;
+        return 1;
+    }
+    return 0;
+}
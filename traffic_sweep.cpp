@@ -0,0 +1,267 @@
+// Parameter sweep over the signal controller's settings.
+//
+// Each parameter is given either as a list of values or as a range:
+//   minGreen=2,3,4        grid over the listed values
+//   emaAlpha=0.5:0.9:0.1  grid from 0.5 to 0.9 in steps of 0.1
+//   maxGreen=6:14         range, sampled uniformly with --random N
+// Without --random the full Cartesian grid is run; with it, N points are drawn.
+// Points are decoded from their index on demand, so memory stays bounded by the
+// number of threads however large the grid. Every point runs --replications
+// headless seeds and its averaged metrics are appended to the results table as
+// soon as it finishes.
+//
+// Parameters: greenTime, yellowTime, minGreen, maxGreen, priorityHold, emaAlpha,
+//             highCongestion, extremeCongestion, spawnInterval
+// Points the controller cannot run with (e.g. minGreen above maxGreen) are
+// reported and skipped.
+//
+// Usage: traffic_sweep [--random N] [--replications 3] [--seconds 3600] [--dt 0.1]
+//                      [--lanes 1] [--seed 1] [--threads N] [--out sweep.csv]
+//                      name=spec ...
+
+#include "TrafficManager.hpp"
+#include "QTableLoader.hpp"
+#include "SimRng.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SweepParameter {
+    const char* name;
+    void (*apply)(SimConfig&, double);
+};
+
+static const SweepParameter kSweepParameters[] = {
+    { "greenTime",         [](SimConfig& c, double v) { c.controller.greenTime = static_cast<float>(v); } },
+    { "yellowTime",        [](SimConfig& c, double v) { c.controller.yellowTime = static_cast<float>(v); } },
+    { "minGreen",          [](SimConfig& c, double v) { c.controller.minGreen = static_cast<float>(v); } },
+    { "maxGreen",          [](SimConfig& c, double v) { c.controller.maxGreen = static_cast<float>(v); } },
+    { "priorityHold",      [](SimConfig& c, double v) { c.controller.priorityHold = static_cast<float>(v); } },
+    { "emaAlpha",          [](SimConfig& c, double v) { c.controller.emaAlpha = static_cast<float>(v); } },
+    { "highCongestion",    [](SimConfig& c, double v) { c.controller.highCongestion = static_cast<int>(std::lround(v)); } },
+    { "extremeCongestion", [](SimConfig& c, double v) { c.controller.extremeCongestion = static_cast<int>(std::lround(v)); } },
+    { "spawnInterval",     [](SimConfig& c, double v) { c.spawnInterval = static_cast<float>(v); } },
+};
+
+// One swept dimension: either discrete values, or a continuous [lo, hi] range.
+struct Dimension {
+    const SweepParameter* param = nullptr;
+    std::vector<double> values;
+    double lo = 0.0;
+    double hi = 0.0;
+    bool range = false;
+};
+
+static bool parseDimension(const std::string& arg, Dimension& dim) {
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+        return false;
+    }
+    std::string name = arg.substr(0, eq);
+    for (const SweepParameter& p : kSweepParameters) {
+        if (name == p.name) dim.param = &p;
+    }
+    if (!dim.param) {
+        std::cerr << "Unknown sweep parameter: " << name << std::endl;
+        return false;
+    }
+
+    std::string spec = arg.substr(eq + 1);
+    if (spec.find(':') != std::string::npos) {
+        // lo:hi is a range; lo:hi:step expands to a list.
+        std::vector<double> parts;
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ':')) parts.push_back(std::atof(item.c_str()));
+        if (parts.size() == 2) {
+            dim.range = true;
+            dim.lo = parts[0];
+            dim.hi = parts[1];
+            return dim.hi >= dim.lo;
+        }
+        if (parts.size() != 3 || parts[2] <= 0.0 || parts[1] < parts[0]) {
+            return false;
+        }
+        // Each value is computed from its index, so rounding in the step does not
+        // accumulate and drop (or add) the last value.
+        long long steps = static_cast<long long>(std::floor((parts[1] - parts[0]) / parts[2] + 1e-6));
+        for (long long k = 0; k <= steps; ++k) {
+            dim.values.push_back(parts[0] + k * parts[2]);
+        }
+    } else {
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!item.empty()) dim.values.push_back(std::atof(item.c_str()));
+        }
+    }
+    return !dim.values.empty();
+}
+
+// Parameter values of point `index`: mixed-radix digits of the index for a grid,
+// or uniform draws from a stream seeded by the index for random search.
+static std::vector<double> pointValues(const std::vector<Dimension>& dims, long long index,
+                                       bool random, std::uint64_t seed) {
+    std::vector<double> values(dims.size());
+    SimRng rng{ seed * 0x9E3779B97F4A7C15ULL + static_cast<std::uint64_t>(index) + 1 };
+    for (size_t d = dims.size(); d-- > 0;) {
+        const Dimension& dim = dims[d];
+        if (random) {
+            values[d] = dim.range
+                ? dim.lo + (dim.hi - dim.lo) * rng.nextFloat()
+                : dim.values[rng.nextInt(static_cast<int>(dim.values.size()))];
+        } else {
+            long long n = static_cast<long long>(dim.values.size());
+            values[d] = dim.values[index % n];
+            index /= n;
+        }
+    }
+    return values;
+}
+
+int main(int argc, char* argv[]) {
+    long long randomPoints = 0;
+    int replications = 3;
+    float seconds = 3600.f;
+    float dt = 0.1f;
+    std::uint64_t seed = 1;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    std::string outFile = "sweep.csv";
+    SimConfig base;
+    base.headless = true;
+    base.verbose = false;
+    std::vector<Dimension> dims;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--random" && i + 1 < argc) randomPoints = std::atoll(argv[++i]);
+        else if (arg == "--replications" && i + 1 < argc) replications = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--dt" && i + 1 < argc) dt = std::atof(argv[++i]);
+        else if (arg == "--lanes" && i + 1 < argc) base.lanesPerApproach = std::atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) outFile = argv[++i];
+        else {
+            Dimension dim;
+            if (!parseDimension(arg, dim)) {
+                std::cerr << "Invalid argument: " << arg << std::endl;
+                return 1;
+            }
+            dims.push_back(dim);
+        }
+    }
+    if (dims.empty()) {
+        std::cerr << "No parameters to sweep, e.g. minGreen=2,3,4 maxGreen=8:14:2" << std::endl;
+        return 1;
+    }
+
+    bool random = randomPoints > 0;
+    long long points = random ? randomPoints : 1;
+    for (const Dimension& dim : dims) {
+        if (dim.range && !random) {
+            std::cerr << dim.param->name << ": a lo:hi range needs --random N (or give lo:hi:step)" << std::endl;
+            return 1;
+        }
+        if (!random) points *= static_cast<long long>(dim.values.size());
+    }
+    threads = static_cast<int>(std::clamp<long long>(threads, 1, points));
+
+    std::ofstream out(outFile);
+    if (!out.is_open()) {
+        std::cerr << "Unable to write " << outFile << std::endl;
+        return 1;
+    }
+    out << "point";
+    for (const Dimension& dim : dims) out << ',' << dim.param->name;
+    out << ",delay_s,throughput_vph,max_queue\n";
+
+    // One Q-table shared by every run.
+    base.qTable = std::make_shared<const DenseQTable>(QTableLoader::loadDenseQTable(base.qTablePath));
+
+    std::atomic<long long> nextPoint{0};
+    std::atomic<long long> finished{0};
+    std::mutex outMutex;
+    double bestDelay = INFINITY;
+    long long bestPoint = -1;
+
+    auto worker = [&]() {
+        for (long long p = nextPoint.fetch_add(1); p < points; p = nextPoint.fetch_add(1)) {
+            std::vector<double> values = pointValues(dims, p, random, seed);
+            SimConfig config = base;
+            for (size_t d = 0; d < dims.size(); ++d) {
+                dims[d].param->apply(config, values[d]);
+            }
+
+            std::string reason;
+            if (!config.controller.isValid(&reason) || !(config.spawnInterval > 0.f)) {
+                std::lock_guard<std::mutex> lock(outMutex);
+                std::cerr << "Skipping point " << p << ": "
+                          << (reason.empty() ? "spawnInterval must be positive" : reason) << std::endl;
+                ++finished;
+                continue;
+            }
+
+            // Common random numbers: replication r uses the same seed at every point.
+            double delay = 0.0, throughput = 0.0, maxQueue = 0.0;
+            for (int r = 0; r < replications; ++r) {
+                config.seed = seed + static_cast<std::uint64_t>(r);
+                TrafficManager manager(config);
+                int ticks = std::max(1, static_cast<int>(seconds / dt));
+                for (int t = 0; t < ticks; ++t) {
+                    manager.update(dt);
+                }
+                const SimMetrics& m = manager.getMetrics();
+                delay += m.meanDelay();
+                throughput += m.vehiclesServed * 3600.0 / manager.getSimTime();
+                maxQueue += m.maxQueue;
+            }
+            delay /= replications;
+            throughput /= replications;
+            maxQueue /= replications;
+
+            std::lock_guard<std::mutex> lock(outMutex);
+            out << p;
+            for (double v : values) out << ',' << v;
+            out << ',' << delay << ',' << throughput << ',' << maxQueue << '\n';
+            out.flush();
+            if (delay < bestDelay) {
+                bestDelay = delay;
+                bestPoint = p;
+            }
+            long long done = ++finished;
+            if (done % 10 == 0 || done == points) {
+                std::cout << done << "/" << points << " points done" << std::endl;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    if (bestPoint < 0) {
+        std::cerr << "No valid points to run" << std::endl;
+        return 1;
+    }
+    std::cout << "Results written to " << outFile << "\nLowest mean delay " << bestDelay << " s at point "
+              << bestPoint << ":";
+    std::vector<double> best = pointValues(dims, bestPoint, random, seed);
+    for (size_t d = 0; d < dims.size(); ++d) {
+        std::cout << ' ' << dims[d].param->name << '=' << best[d];
+    }
+    std::cout << std::endl;
+    return 0;
+}
@@ -0,0 +1,492 @@
+// Native Q-learning trainer that uses the headless simulation itself as the
+// environment. A step is one phase-end decision: the trainer reads the measured
+// queues, picks an action (0 = keep, 1 = +1 s green, 2 = -1 s green, the
+// semantics applyRLDecision uses), and runs the simulation to the next decision
+// for the reward and next state. Each episode is a fresh intersection with its
+// own seed and a spawn interval drawn from [--spawn-min, --spawn-max].
+//
+// Episodes are shared out to --threads actors, each stepping its own
+// simulation. All actors update one shared Q-table Hogwild-style: values are
+// relaxed atomic loads and stores without locks, so a concurrent update can
+// occasionally be lost, which Q-learning tolerates. --scaling 1,2,4,... instead
+// trains from scratch once per thread count and reports decisions/sec.
+//
+// The learned table is written as JSON (.json) or as a binary policy file
+// (any other extension), both of which the simulation loads. --linear D instead
+// trains a linear policy over degree-D polynomial features of the full
+// observation (see LinearPolicy.hpp), on one actor, written as a .tlp file.
+// --mlp 64,64 trains an MLP Q-network (see MlpPolicy.hpp) from a replay window
+// of recent decisions, on one actor, written as a .tnn file.
+//
+// Usage: traffic_train [--episodes 2000] [--episode-decisions 200] [--alpha 0.1]
+//                      [--gamma 0.95] [--epsilon 0.3] [--epsilon-min 0.02]
+//                      [--epsilon-decay 0.999] [--spawn-min 0.4] [--spawn-max 3]
+//                      [--max-queue 64] [--dt 0.1] [--lanes 1] [--seed 1]
+//                      [--threads N] [--scaling 1,2,4,8,16,32,64] [--linear D]
+//                      [--mlp 64,64] [--lr 0.001]
+//                      [--init q_table.json] [--out q_table.json]
+
+#include "TrafficManager.hpp"
+#include "QTableLoader.hpp"
+#include "LinearPolicy.hpp"
+#include "MlpPolicy.hpp"
+#include "SimRng.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Longest simulated wait for the next decision before an episode is cut short.
+static const float kDecisionTimeout = 120.f;
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Q-table shared by the actors, laid out like DenseQTable ([ns][ew][action]).
+// Every access is a relaxed atomic load or store: plain moves on x86, with no
+// locks or read-modify-write, so actors never wait for each other. Values start
+// at zero, so there is no lazy first-visit initialisation for two actors to
+// race on (one resetting a row the other has just updated); which states were
+// visited is tracked in a separate flag per row, only for toDense().
+class SharedQTable {
+public:
+    SharedQTable(int nsStates, int ewStates)
+        : nsCount(nsStates), ewCount(ewStates),
+          q(new std::atomic<double>[static_cast<size_t>(nsStates) * ewStates * kQActions]),
+          visited(new std::atomic<bool>[static_cast<size_t>(nsStates) * ewStates]) {
+        size_t rows = static_cast<size_t>(nsCount) * ewCount;
+        for (size_t i = 0; i < rows * kQActions; ++i) q[i].store(0.0, std::memory_order_relaxed);
+        for (size_t i = 0; i < rows; ++i) visited[i].store(false, std::memory_order_relaxed);
+    }
+
+    // Values of a state for training (see rowIndex); a state seen for the first
+    // time reads as zero.
+    std::atomic<double>* row(std::pair<int, int> state) {
+        size_t index = rowIndex(state.first, state.second);
+        // Only the first visit writes the flag, so later visits leave its cache line shared.
+        if (!visited[index].load(std::memory_order_relaxed)) visited[index].store(true, std::memory_order_relaxed);
+        return &q[index * kQActions];
+    }
+
+    // Row of a state, queues beyond the table clamped to its edge.
+    size_t rowIndex(int ns, int ew) const {
+        ns = std::clamp(ns, 0, nsCount - 1);
+        ew = std::clamp(ew, 0, ewCount - 1);
+        return static_cast<size_t>(ns) * ewCount + ew;
+    }
+
+    static void load(const std::atomic<double>* values, double out[kQActions]) {
+        for (int a = 0; a < kQActions; ++a) out[a] = values[a].load(std::memory_order_relaxed);
+    }
+
+    // Seeds the known states of `table`; its unknown states stay unvisited.
+    void copyFrom(const DenseQTable& table) {
+        for (int ns = 0; ns < std::min(nsCount, table.nsStates()); ++ns) {
+            for (int ew = 0; ew < std::min(ewCount, table.ewStates()); ++ew) {
+                const double* values = table.values(ns, ew);
+                if (!DenseQTable::isKnown(values)) continue;
+                size_t index = rowIndex(ns, ew);
+                for (int a = 0; a < kQActions; ++a) q[index * kQActions + a].store(values[a], std::memory_order_relaxed);
+                visited[index].store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // The learned table; states no actor visited stay unknown.
+    DenseQTable toDense() const {
+        DenseQTable table(nsCount, ewCount);
+        for (int ns = 0; ns < nsCount; ++ns) {
+            for (int ew = 0; ew < ewCount; ++ew) {
+                size_t index = rowIndex(ns, ew);
+                if (!visited[index].load(std::memory_order_relaxed)) continue;
+                double* values = table.mutableValues(ns, ew);
+                for (int a = 0; a < kQActions; ++a) values[a] = q[index * kQActions + a].load(std::memory_order_relaxed);
+            }
+        }
+        return table;
+    }
+
+private:
+    int nsCount;
+    int ewCount;
+    std::unique_ptr<std::atomic<double>[]> q;
+    std::unique_ptr<std::atomic<bool>[]> visited;
+};
+
+struct TrainSettings {
+    int episodes = 2000;
+    int episodeDecisions = 200;
+    double alpha = 0.1;
+    double gamma = 0.95;
+    double epsilon = 0.3;
+    double epsilonMin = 0.02;
+    double epsilonDecay = 0.999;
+    float spawnMin = 0.4f;
+    float spawnMax = 3.f;
+    float dt = 0.1f;
+    std::uint64_t seed = 1;
+    bool progress = true;
+    SimConfig base;
+};
+
+struct TrainResult {
+    long long decisions = 0;
+    double rewardSum = 0.0;
+    double seconds = 0.0;
+};
+
+// Runs the episodes on `threads` actors against the shared table.
+static TrainResult train(const TrainSettings& settings, SharedQTable& table, int threads) {
+    std::atomic<int> nextEpisode{0};
+    std::atomic<long long> totalDecisions{0};
+    std::mutex resultMutex;
+    TrainResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    auto actor = [&](int id) {
+        SimRng rng(settings.seed * 0x9E3779B97F4A7C15ull + static_cast<std::uint64_t>(id) + 1);
+        long long decisions = 0;
+        double rewardSum = 0.0;
+        for (int episode = nextEpisode.fetch_add(1); episode < settings.episodes; episode = nextEpisode.fetch_add(1)) {
+            SimConfig config = settings.base;
+            config.seed = settings.seed + static_cast<std::uint64_t>(episode) + 1;
+            config.spawnInterval = settings.spawnMin + (settings.spawnMax - settings.spawnMin) * rng.nextFloat();
+            TrafficManager env(config);
+            double eps = std::max(settings.epsilonMin, settings.epsilon * std::pow(settings.epsilonDecay, episode));
+
+            long long episodeDecisions = 0;
+            if (env.runToDecision(settings.dt, kDecisionTimeout)) {
+                std::pair<int, int> state = env.getQueueState();
+                for (int step = 0; step < settings.episodeDecisions; ++step) {
+                    std::atomic<double>* q = table.row(state);
+                    double values[kQActions];
+                    SharedQTable::load(q, values);
+                    int action = rng.nextFloat() < eps ? rng.nextInt(kQActions) : DenseQTable::argmax(values);
+                    env.applyAction(action);
+                    if (!env.runToDecision(settings.dt, kDecisionTimeout)) {
+                        break;
+                    }
+                    double reward = env.getLastReward();
+                    std::pair<int, int> next = env.getQueueState();
+                    double nextValues[kQActions];
+                    SharedQTable::load(table.row(next), nextValues);
+                    double target = reward + settings.gamma * std::max({ nextValues[0], nextValues[1], nextValues[2] });
+                    double current = q[action].load(std::memory_order_relaxed);
+                    q[action].store(current + settings.alpha * (target - current), std::memory_order_relaxed);
+
+                    state = next;
+                    rewardSum += reward;
+                    ++episodeDecisions;
+                }
+            }
+            decisions += episodeDecisions;
+            long long done = totalDecisions.fetch_add(episodeDecisions) + episodeDecisions;
+            if (settings.progress && (episode + 1) % 100 == 0) {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::printf("Episode %d: epsilon %.3f, %lld decisions (%.0f/s, %.1fM/h)\n", episode + 1, eps, done,
+                            done / seconds, done / seconds * 3600.0 / 1e6);
+                std::fflush(stdout);
+            }
+        }
+        std::lock_guard<std::mutex> lock(resultMutex);
+        result.decisions += decisions;
+        result.rewardSum += rewardSum;
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back(actor, t);
+    }
+    for (auto& t : pool) {
+        t.join();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Semi-gradient Q-learning of a linear policy. The step is normalised by the
+// squared feature norm, so one learning rate suits every degree. The weights
+// are not shared, so this runs on a single actor.
+static TrainResult trainLinear(const TrainSettings& settings, LinearPolicy& policy) {
+    TrainResult result;
+    SimRng rng(settings.seed * 0x9E3779B97F4A7C15ull + 1);
+    std::vector<float> phi(policy.getFeatureCount());
+    auto start = std::chrono::steady_clock::now();
+
+    for (int episode = 0; episode < settings.episodes; ++episode) {
+        SimConfig config = settings.base;
+        config.seed = settings.seed + static_cast<std::uint64_t>(episode) + 1;
+        config.spawnInterval = settings.spawnMin + (settings.spawnMax - settings.spawnMin) * rng.nextFloat();
+        TrafficManager env(config);
+        double eps = std::max(settings.epsilonMin, settings.epsilon * std::pow(settings.epsilonDecay, episode));
+
+        if (env.runToDecision(settings.dt, kDecisionTimeout)) {
+            float observation[kObservationSize];
+            env.getObservation(observation);
+            for (int step = 0; step < settings.episodeDecisions; ++step) {
+                float q[kQActions];
+                policy.evaluate(observation, q);
+                policy.features(observation, phi.data());
+                int action = rng.nextFloat() < eps ? rng.nextInt(kQActions) : policy.greedy(observation);
+                env.applyAction(action);
+                if (!env.runToDecision(settings.dt, kDecisionTimeout)) {
+                    break;
+                }
+                double reward = env.getLastReward();
+                env.getObservation(observation);
+                float next[kQActions];
+                policy.evaluate(observation, next);
+                double target = reward + settings.gamma * std::max({ next[0], next[1], next[2] });
+                double norm = 0.0;
+                for (float f : phi) norm += f * f;
+                policy.update(phi.data(), action, static_cast<float>(settings.alpha * (target - q[action]) / norm));
+
+                result.rewardSum += reward;
+                ++result.decisions;
+            }
+        }
+        if (settings.progress && (episode + 1) % 100 == 0) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("Episode %d: epsilon %.3f, %lld decisions (%.0f/s), mean reward %.3f\n", episode + 1, eps,
+                        result.decisions, result.decisions / seconds,
+                        result.decisions > 0 ? result.rewardSum / result.decisions : 0.0);
+            std::fflush(stdout);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Q-learning of an MLP policy. Each decision goes into a replay window and
+// trains the network on a minibatch sampled from it, against a target network
+// refreshed every kTargetSync decisions. Single actor, like trainLinear.
+static const int kReplayCapacity = 50000;
+static const int kMinibatch = 32;
+static const int kTargetSync = 1000;
+
+struct Experience {
+    float observation[kObservationSize];
+    int action;
+    float reward;
+    float next[kObservationSize];
+};
+
+static TrainResult trainMlp(const TrainSettings& settings, MlpPolicy& policy, float learningRate) {
+    TrainResult result;
+    SimRng rng(settings.seed * 0x9E3779B97F4A7C15ull + 1);
+    std::vector<Experience> replay;
+    replay.reserve(kReplayCapacity);
+    MlpPolicy target = policy;
+    std::vector<float> batchObservations(static_cast<size_t>(kMinibatch) * kObservationSize);
+    std::vector<int> batchActions(kMinibatch);
+    std::vector<float> batchTargets(kMinibatch);
+    double lossSum = 0.0;
+    long long lossCount = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int episode = 0; episode < settings.episodes; ++episode) {
+        SimConfig config = settings.base;
+        config.seed = settings.seed + static_cast<std::uint64_t>(episode) + 1;
+        config.spawnInterval = settings.spawnMin + (settings.spawnMax - settings.spawnMin) * rng.nextFloat();
+        TrafficManager env(config);
+        double eps = std::max(settings.epsilonMin, settings.epsilon * std::pow(settings.epsilonDecay, episode));
+
+        if (env.runToDecision(settings.dt, kDecisionTimeout)) {
+            Experience e;
+            env.getObservation(e.observation);
+            for (int step = 0; step < settings.episodeDecisions; ++step) {
+                e.action = rng.nextFloat() < eps ? rng.nextInt(kQActions) : policy.greedy(e.observation);
+                env.applyAction(e.action);
+                if (!env.runToDecision(settings.dt, kDecisionTimeout)) {
+                    break;
+                }
+                e.reward = static_cast<float>(env.getLastReward());
+                env.getObservation(e.next);
+                if (replay.size() < static_cast<size_t>(kReplayCapacity)) {
+                    replay.push_back(e);
+                } else {
+                    replay[result.decisions % kReplayCapacity] = e;
+                }
+                result.rewardSum += e.reward;
+                ++result.decisions;
+
+                if (replay.size() >= static_cast<size_t>(kMinibatch)) {
+                    for (int b = 0; b < kMinibatch; ++b) {
+                        const Experience& x = replay[rng.nextInt(static_cast<int>(replay.size()))];
+                        float q[kQActions];
+                        target.evaluate(x.next, q);
+                        std::copy(x.observation, x.observation + kObservationSize,
+                                  &batchObservations[static_cast<size_t>(b) * kObservationSize]);
+                        batchActions[b] = x.action;
+                        batchTargets[b] = static_cast<float>(x.reward + settings.gamma * std::max({ q[0], q[1], q[2] }));
+                    }
+                    lossSum += policy.train(batchObservations.data(), batchActions.data(), batchTargets.data(),
+                                            kMinibatch, learningRate);
+                    ++lossCount;
+                }
+                if (result.decisions % kTargetSync == 0) {
+                    target = policy;
+                }
+                std::copy(e.next, e.next + kObservationSize, e.observation);
+            }
+        }
+        if (settings.progress && (episode + 1) % 100 == 0) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("Episode %d: epsilon %.3f, %lld decisions (%.0f/s), mean reward %.3f, loss %.4f\n",
+                        episode + 1, eps, result.decisions, result.decisions / seconds,
+                        result.decisions > 0 ? result.rewardSum / result.decisions : 0.0,
+                        lossCount > 0 ? lossSum / lossCount : 0.0);
+            std::fflush(stdout);
+            lossSum = 0.0;
+            lossCount = 0;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+static std::vector<int> parseCounts(const std::string& text) {
+    std::vector<int> counts;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) counts.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    return counts;
+}
+
+int main(int argc, char* argv[]) {
+    TrainSettings settings;
+    int maxQueue = 64;
+    int lanes = 1;
+    int threads = static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<int> scaling;
+    int linearDegree = 0;
+    std::vector<int> mlpHidden;
+    float learningRate = 0.001f;
+    std::string initFile;
+    std::string outFile = "q_table.json";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--episodes" && i + 1 < argc) settings.episodes = std::atoi(argv[++i]);
+        else if (arg == "--episode-decisions" && i + 1 < argc) settings.episodeDecisions = std::atoi(argv[++i]);
+        else if (arg == "--alpha" && i + 1 < argc) settings.alpha = std::atof(argv[++i]);
+        else if (arg == "--gamma" && i + 1 < argc) settings.gamma = std::atof(argv[++i]);
+        else if (arg == "--epsilon" && i + 1 < argc) settings.epsilon = std::atof(argv[++i]);
+        else if (arg == "--epsilon-min" && i + 1 < argc) settings.epsilonMin = std::atof(argv[++i]);
+        else if (arg == "--epsilon-decay" && i + 1 < argc) settings.epsilonDecay = std::atof(argv[++i]);
+        else if (arg == "--spawn-min" && i + 1 < argc) settings.spawnMin = std::atof(argv[++i]);
+        else if (arg == "--spawn-max" && i + 1 < argc) settings.spawnMax = std::atof(argv[++i]);
+        else if (arg == "--max-queue" && i + 1 < argc) maxQueue = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--dt" && i + 1 < argc) settings.dt = std::atof(argv[++i]);
+        else if (arg == "--lanes" && i + 1 < argc) lanes = std::atoi(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) settings.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--scaling" && i + 1 < argc) scaling = parseCounts(argv[++i]);
+        else if (arg == "--linear" && i + 1 < argc) linearDegree = std::atoi(argv[++i]);
+        else if (arg == "--mlp" && i + 1 < argc) mlpHidden = parseCounts(argv[++i]);
+        else if (arg == "--lr" && i + 1 < argc) learningRate = std::atof(argv[++i]);
+        else if (arg == "--init" && i + 1 < argc) initFile = argv[++i];
+        else if (arg == "--out" && i + 1 < argc) outFile = argv[++i];
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+    threads = std::max(1, threads);
+
+    settings.base.lanesPerApproach = lanes;
+    settings.base.headless = true;
+    settings.base.verbose = false;
+    settings.base.externalControl = true;
+    // The simulation's own table is never consulted under external control.
+    settings.base.qTable = std::make_shared<const DenseQTable>();
+
+    if (!mlpHidden.empty()) {
+        MlpPolicy policy(mlpHidden, settings.seed);
+        if (!initFile.empty() && !MlpPolicy::load(initFile, policy)) {
+            return 1;
+        }
+        std::printf("MLP policy: %d layers, %zu parameters\n", policy.getLayerCount(), policy.getParameterCount());
+        TrainResult result = trainMlp(settings, policy, learningRate);
+        std::printf("%lld decisions in %.1f s (%.0f/s), mean reward %.3f\n", result.decisions, result.seconds,
+                    result.decisions / result.seconds,
+                    result.decisions > 0 ? result.rewardSum / result.decisions : 0.0);
+        if (endsWith(outFile, ".json")) {
+            outFile.replace(outFile.size() - 5, 5, ".tnn");
+        }
+        if (!policy.save(outFile)) {
+            return 1;
+        }
+        std::cout << "Training complete. MLP policy written to " << outFile << std::endl;
+        return 0;
+    }
+
+    if (linearDegree > 0) {
+        LinearPolicy policy(linearDegree);
+        if (!initFile.empty() && !LinearPolicy::load(initFile, policy)) {
+            return 1;
+        }
+        std::printf("Linear policy: degree %d, %d features\n", policy.getDegree(), policy.getFeatureCount());
+        TrainResult result = trainLinear(settings, policy);
+        std::printf("%lld decisions in %.1f s (%.0f/s), mean reward %.3f\n", result.decisions, result.seconds,
+                    result.decisions / result.seconds,
+                    result.decisions > 0 ? result.rewardSum / result.decisions : 0.0);
+        if (endsWith(outFile, ".json")) {
+            outFile.replace(outFile.size() - 5, 5, ".tlp");
+        }
+        if (!policy.save(outFile)) {
+            return 1;
+        }
+        std::cout << "Training complete. Linear policy written to " << outFile << std::endl;
+        return 0;
+    }
+
+    if (!scaling.empty()) {
+        // Same workload at every thread count, each on a fresh table.
+        settings.progress = false;
+        std::printf("%8s %12s %14s %10s %12s\n", "threads", "decisions", "decisions/s", "speed-up", "mean reward");
+        double baseline = 0.0;
+        for (int count : scaling) {
+            SharedQTable table(maxQueue + 1, maxQueue + 1);
+            TrainResult result = train(settings, table, count);
+            double rate = result.decisions / result.seconds;
+            if (baseline == 0.0) baseline = rate;
+            std::printf("%8d %12lld %14.0f %10.2f %12.3f\n", count, result.decisions, rate, rate / baseline,
+                        result.decisions > 0 ? result.rewardSum / result.decisions : 0.0);
+            std::fflush(stdout);
+        }
+        return 0;
+    }
+
+    // States 0..maxQueue on both axes, optionally seeded from an existing table.
+    SharedQTable table(maxQueue + 1, maxQueue + 1);
+    if (!initFile.empty()) {
+        table.copyFrom(QTableLoader::loadDenseQTable(initFile));
+    }
+    TrainResult result = train(settings, table, threads);
+    std::printf("%lld decisions on %d threads in %.1f s (%.0f/s, %.1fM/h), mean reward %.3f\n", result.decisions,
+                threads, result.seconds, result.decisions / result.seconds,
+                result.decisions / result.seconds * 3600.0 / 1e6,
+                result.decisions > 0 ? result.rewardSum / result.decisions : 0.0);
+
+    DenseQTable learned = table.toDense();
+    bool saved = endsWith(outFile, ".json")
+        ? QTableLoader::saveQTable(learned.toQTable(), outFile)
+        : QTableLoader::savePolicyFile(learned, outFile);
+    if (!saved) {
+        return 1;
+    }
+    std::cout << "Training complete. Q-table written to " << outFile << std::endl;
+    return 0;
+}
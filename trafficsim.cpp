@@ -0,0 +1,159 @@
+#define TRAFFICSIM_BUILD
+#include "trafficsim.h"
+#include "BatchEnv.hpp"
+#include "TrafficManager.hpp"
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+
+// BatchEnv works on int buffers; the C interface promises int32_t.
+static_assert(std::is_same<int, int32_t>::value, "trafficsim requires a 32-bit int");
+
+// Step and decision wait used by both kinds of environment.
+static const float kStep = 0.1f;
+static const float kMaxDecisionWait = 120.f;
+
+struct ts_env {
+    SimConfig config;
+    SimRng seeds{1};
+    std::unique_ptr<TrafficManager> sim;
+};
+
+struct ts_batch {
+    std::unique_ptr<BatchEnv> env;
+};
+
+static void writeState(const TrafficManager& sim, int32_t* state) {
+    std::pair<int, int> queues = sim.getQueueState();
+    state[0] = queues.first;
+    state[1] = queues.second;
+}
+
+extern "C" {
+
+int ts_api_version(void) {
+    return TRAFFICSIM_API_VERSION;
+}
+
+ts_env* ts_create(int lanes_per_approach, double spawn_interval) {
+    try {
+        std::unique_ptr<ts_env> env(new ts_env);
+        env->config.lanesPerApproach = std::clamp(lanes_per_approach, 1, TrafficManager::kMaxLanes);
+        env->config.spawnInterval = static_cast<float>(spawn_interval);
+        env->config.headless = true;
+        env->config.verbose = false;
+        env->config.externalControl = true;
+        env->config.qTable = std::make_shared<const DenseQTable>();
+        return env.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void ts_destroy(ts_env* env) {
+    delete env;
+}
+
+void ts_seed(ts_env* env, uint64_t seed) {
+    env->seeds = SimRng(seed);
+}
+
+int ts_reset(ts_env* env, int32_t* state) {
+    try {
+        SimConfig config = env->config;
+        // Keep clear of 0, which would seed from the clock.
+        config.seed = env->seeds.next() | 1;
+        env->sim = std::make_unique<TrafficManager>(config);
+        bool decided = env->sim->runToDecision(kStep, kMaxDecisionWait);
+        writeState(*env->sim, state);
+        return decided ? 0 : -1;
+    } catch (...) {
+        env->sim.reset();
+        state[0] = state[1] = 0;
+        return -1;
+    }
+}
+
+int ts_step(ts_env* env, int action, int32_t* state, double* reward) {
+    if (!env->sim) {
+        state[0] = state[1] = 0;
+        *reward = 0.0;
+        return 1;
+    }
+    try {
+        env->sim->applyAction(action);
+        bool decided = env->sim->runToDecision(kStep, kMaxDecisionWait);
+        writeState(*env->sim, state);
+        *reward = decided ? env->sim->getLastReward() : 0.0;
+        return decided ? 0 : 1;
+    } catch (...) {
+        env->sim.reset();
+        state[0] = state[1] = 0;
+        *reward = 0.0;
+        return -1;
+    }
+}
+
+void ts_state(const ts_env* env, int32_t* state) {
+    if (env->sim) {
+        writeState(*env->sim, state);
+    } else {
+        state[0] = state[1] = 0;
+    }
+}
+
+double ts_reward(const ts_env* env) {
+    return env->sim ? env->sim->getLastReward() : 0.0;
+}
+
+ts_batch* ts_batch_create(int size, int lanes_per_approach, double spawn_min, double spawn_max,
+                          int episode_decisions, int threads) {
+    try {
+        BatchEnvConfig config;
+        config.sim.lanesPerApproach = std::clamp(lanes_per_approach, 1, TrafficManager::kMaxLanes);
+        config.dt = kStep;
+        config.maxDecisionWait = kMaxDecisionWait;
+        config.episodeDecisions = std::max(episode_decisions, 0);
+        config.spawnMin = static_cast<float>(spawn_min);
+        config.spawnMax = static_cast<float>(spawn_max);
+        config.threads = threads;
+        std::unique_ptr<ts_batch> batch(new ts_batch);
+        batch->env = std::make_unique<BatchEnv>(std::max(size, 1), config);
+        return batch.release();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void ts_batch_destroy(ts_batch* batch) {
+    delete batch;
+}
+
+int ts_batch_size(const ts_batch* batch) {
+    try {
+        return batch->env->size();
+    } catch (...) {
+        return -1;
+    }
+}
+
+int ts_batch_reset(ts_batch* batch, uint64_t seed, int32_t* queue_ns, int32_t* queue_ew) {
+    try {
+        batch->env->reset(seed, queue_ns, queue_ew);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+int ts_batch_step(ts_batch* batch, const int32_t* actions, int32_t* queue_ns, int32_t* queue_ew,
+                  double* rewards, uint8_t* done) {
+    try {
+        batch->env->step(actions, queue_ns, queue_ew, rewards, done);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+}
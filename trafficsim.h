@@ -0,0 +1,79 @@
+/*
+ * C interface to the headless simulation, built as libtrafficsim for use from
+ * Python (ctypes) and other languages. Every call writes into buffers the
+ * caller owns, so NumPy arrays can be passed straight through without copies.
+ *
+ * A state is the pair of measured queues (NS, EW) at a phase-end decision.
+ * Actions are those of the simulation's controller: 0 = keep, 1 = +1 s green,
+ * 2 = -1 s green. No call lets a C++ exception escape; creation returns NULL
+ * on failure and the other calls that can fail return -1.
+ */
+#ifndef TRAFFICSIM_H
+#define TRAFFICSIM_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifdef TRAFFICSIM_BUILD
+#define TRAFFICSIM_API __declspec(dllexport)
+#else
+#define TRAFFICSIM_API __declspec(dllimport)
+#endif
+#else
+#define TRAFFICSIM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a signature or its meaning changes. */
+#define TRAFFICSIM_API_VERSION 2
+TRAFFICSIM_API int ts_api_version(void);
+
+/* ---- Single environment ------------------------------------------------ */
+
+typedef struct ts_env ts_env;
+
+/* An intersection with lanes_per_approach lanes (1-3) and a vehicle spawned
+ * every spawn_interval seconds. */
+TRAFFICSIM_API ts_env* ts_create(int lanes_per_approach, double spawn_interval);
+TRAFFICSIM_API void ts_destroy(ts_env* env);
+/* Seed of the next reset; each reset after that advances it. */
+TRAFFICSIM_API void ts_seed(ts_env* env, uint64_t seed);
+/* Starts a fresh episode and runs to its first decision; state[2] receives the
+ * queues. Returns 0, or -1 if no decision came within the wait limit. */
+TRAFFICSIM_API int ts_reset(ts_env* env, int32_t* state);
+/* Applies the action and runs to the next decision. Returns 1 when the episode
+ * has ended (no decision within the wait limit; call ts_reset), 0 otherwise,
+ * and -1 if the simulation failed (it is discarded; call ts_reset). */
+TRAFFICSIM_API int ts_step(ts_env* env, int action, int32_t* state, double* reward);
+TRAFFICSIM_API void ts_state(const ts_env* env, int32_t* state);
+TRAFFICSIM_API double ts_reward(const ts_env* env);
+
+/* ---- Batched environments ---------------------------------------------- */
+
+typedef struct ts_batch ts_batch;
+
+/* size independent intersections. Each episode draws its spawn interval from
+ * [spawn_min, spawn_max] and lasts episode_decisions decisions (0 = until a
+ * decision times out), after which it restarts in place. threads > 1 steps
+ * slices of the batch in parallel on threads started here. */
+TRAFFICSIM_API ts_batch* ts_batch_create(int size, int lanes_per_approach, double spawn_min, double spawn_max,
+                                         int episode_decisions, int threads);
+TRAFFICSIM_API void ts_batch_destroy(ts_batch* batch);
+/* Returns -1 on failure. */
+TRAFFICSIM_API int ts_batch_size(const ts_batch* batch);
+/* Buffers hold size entries each. Returns 0, or -1 on failure. */
+TRAFFICSIM_API int ts_batch_reset(ts_batch* batch, uint64_t seed, int32_t* queue_ns, int32_t* queue_ew);
+/* done[i] = 1 marks an episode that ended on this step; queue_ns/queue_ew[i]
+ * are then already the first state of its next episode. Returns 0, or -1 on
+ * failure. */
+TRAFFICSIM_API int ts_batch_step(ts_batch* batch, const int32_t* actions, int32_t* queue_ns, int32_t* queue_ew,
+                                 double* rewards, uint8_t* done);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif